@@ -0,0 +1,70 @@
+// Compares bulk_insert against preparing, binding, and stepping one INSERT
+// per row, and prints the throughput of each in rows per second.
+//
+//   apex-bench-insert [rows] [path]
+#include <apex/sqlite/insert.hpp>
+
+#include <filesystem>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+using namespace apex::sqlite;
+
+struct item final {
+  apex::i64 id;
+  std::string name;
+  apex::f64 score;
+};
+
+void per_row (connection& conn, std::vector<item> const& rows) {
+  execute(conn, "BEGIN IMMEDIATE");
+  for (auto const& row : rows) {
+    auto text = std::string_view { "INSERT INTO items VALUES (?, ?, ?)" };
+    statement stmt { conn, text };
+    apex::sqlite::bind(stmt, 1, row.id);
+    apex::sqlite::bind(stmt, 2, std::string_view { row.name });
+    apex::sqlite::bind(stmt, 3, row.score);
+    stmt.execute();
+  }
+  execute(conn, "COMMIT");
+}
+
+template <class F>
+void measure (connection& conn, char const* name, std::vector<item> const& rows, F&& fn) {
+  using clock = std::chrono::steady_clock;
+  execute(conn, "DELETE FROM items");
+  auto const start = clock::now();
+  fn();
+  auto const elapsed = std::chrono::duration<double> { clock::now() - start };
+  std::printf("%-16s %12.0f rows/s\n", name, static_cast<double>(rows.size()) / elapsed.count());
+}
+
+} /* nameless namespace */
+
+int main (int argc, char** argv) {
+  size_t count = 200'000;
+  if (argc > 1) { std::from_chars(argv[1], argv[1] + std::strlen(argv[1]), count); }
+  std::filesystem::path path { argc > 2 ? argv[2] : "apex-bench-insert.db" };
+  std::filesystem::remove(path);
+
+  std::vector<item> rows;
+  rows.reserve(count);
+  for (size_t idx = 0; idx < count; ++idx) {
+    rows.push_back({ static_cast<apex::i64>(idx), "item-" + std::to_string(idx), static_cast<apex::f64>(idx) * 0.5 });
+  }
+
+  {
+    connection conn { path };
+    execute(conn, "CREATE TABLE items (id INTEGER, name TEXT, score REAL)");
+    measure(conn, "per row", rows, [&] { per_row(conn, rows); });
+    measure(conn, "bulk (chunk 1)", rows, [&] { bulk_insert(conn, "items", rows); });
+    measure(conn, "bulk (chunk 64)", rows, [&] { bulk_insert(conn, "items", rows, 64); });
+  }
+  std::filesystem::remove(path);
+}
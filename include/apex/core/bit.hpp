@@ -123,7 +123,7 @@ constexpr auto bit_cast (detail::bit_castable_from<To> auto const& from) noexcep
 #endif /* APEX_CHECK_API(bit_cast, 201806) */
 
 /** @brief a pretty great way to invoke undefined behavior! 🙂 */
-[[noreturn]] void unreachable () noexcept { __builtin_unreachable(); }
+[[noreturn]] inline void unreachable () noexcept { __builtin_unreachable(); }
 
 } /* namespace apex */
 
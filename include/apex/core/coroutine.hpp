@@ -91,6 +91,12 @@ struct coroutine_handle : coroutine_handle<> {
 
 struct noop_coroutine_promise { };
 
+using noop_coroutine_handle = coroutine_handle<noop_coroutine_promise>;
+
+inline noop_coroutine_handle noop_coroutine () noexcept {
+  return noop_coroutine_handle::from_address(__builtin_coro_noop());
+}
+
 struct suspend_never {
   constexpr bool await_ready () const noexcept { return true; }
   constexpr void await_suspend (coroutine_handle<>) const noexcept { }
@@ -0,0 +1,134 @@
+#ifndef APEX_CORE_TASK_HPP
+#define APEX_CORE_TASK_HPP
+
+#include <apex/core/coroutine.hpp>
+#include <apex/core/concepts.hpp>
+
+#include <exception>
+#include <utility>
+#include <variant>
+
+namespace apex {
+
+template <class T=void> struct task;
+
+} /* namespace apex */
+
+namespace apex::detail::task {
+
+struct promise_base {
+  struct final_awaiter final {
+    bool await_ready () const noexcept { return false; }
+    // Returning the continuation (rather than resuming it) lets the compiler
+    // transfer control to it without growing the stack
+    template <class Promise>
+    coroutine_handle<> await_suspend (coroutine_handle<Promise> handle) const noexcept {
+      if (auto next = handle.promise().continuation) { return next; }
+      return noop_coroutine();
+    }
+    void await_resume () const noexcept { }
+  };
+
+  suspend_always initial_suspend () const noexcept { return { }; }
+  final_awaiter final_suspend () const noexcept { return { }; }
+
+  coroutine_handle<> continuation;
+};
+
+template <class T>
+struct promise final : promise_base {
+  ::apex::task<T> get_return_object () noexcept;
+
+  template <class U> requires convertible_to<U, T>
+  void return_value (U&& value) noexcept(::std::is_nothrow_constructible_v<T, U>) {
+    this->result.template emplace<1>(static_cast<U&&>(value));
+  }
+
+  void unhandled_exception () noexcept {
+    this->result.template emplace<2>(::std::current_exception());
+  }
+
+  T get () {
+    if (this->result.index() == 2) { ::std::rethrow_exception(::std::get<2>(this->result)); }
+    return ::std::move(::std::get<1>(this->result));
+  }
+
+private:
+  ::std::variant<::std::monostate, T, ::std::exception_ptr> result;
+};
+
+template <>
+struct promise<void> final : promise_base {
+  ::apex::task<void> get_return_object () noexcept;
+
+  void return_void () const noexcept { }
+  void unhandled_exception () noexcept { this->error = ::std::current_exception(); }
+
+  void get () const {
+    if (this->error) { ::std::rethrow_exception(this->error); }
+  }
+
+private:
+  ::std::exception_ptr error;
+};
+
+} /* namespace apex::detail::task */
+
+namespace apex {
+
+/** @brief A lazily started coroutine, which produces a single T.
+ *
+ * The coroutine does not run until the task is awaited, and the awaiting
+ * coroutine is resumed on whichever thread the task finishes on. Exceptions
+ * thrown by the coroutine are rethrown from the co_await expression.
+ */
+template <class T>
+struct [[nodiscard]] task final {
+  using promise_type = detail::task::promise<T>;
+  using handle_type = coroutine_handle<promise_type>;
+
+  explicit task (handle_type handle) noexcept :
+    handle { handle }
+  { }
+
+  task (task&& that) noexcept :
+    handle { ::std::exchange(that.handle, nullptr) }
+  { }
+  task (task const&) = delete;
+  ~task () noexcept { if (this->handle) { this->handle.destroy(); } }
+
+  task& operator = (task&& that) noexcept {
+    task { ::std::move(that) }.swap(*this);
+    return *this;
+  }
+  task& operator = (task const&) = delete;
+
+  void swap (task& that) noexcept { ::std::swap(this->handle, that.handle); }
+
+  bool await_ready () const noexcept { return not this->handle or this->handle.done(); }
+  coroutine_handle<> await_suspend (coroutine_handle<> awaiting) const noexcept {
+    this->handle.promise().continuation = awaiting;
+    return this->handle;
+  }
+  decltype(auto) await_resume () const { return this->handle.promise().get(); }
+
+private:
+  handle_type handle;
+};
+
+} /* namespace apex */
+
+namespace apex::detail::task {
+
+template <class T>
+::apex::task<T> promise<T>::get_return_object () noexcept {
+  return ::apex::task<T> { coroutine_handle<promise>::from_promise(*this) };
+}
+
+inline ::apex::task<void> promise<void>::get_return_object () noexcept {
+  return ::apex::task<void> { coroutine_handle<promise>::from_promise(*this) };
+}
+
+} /* namespace apex::detail::task */
+
+#endif /* APEX_CORE_TASK_HPP */
@@ -0,0 +1,100 @@
+#ifndef APEX_DETAIL_SQLITE_FIELDS_HPP
+#define APEX_DETAIL_SQLITE_FIELDS_HPP
+
+#include <apex/core/concepts.hpp>
+
+#include <utility>
+#include <tuple>
+
+// Until we have reflection, this is the only way to walk the members of an
+// aggregate. The number of fields is found by probing aggregate
+// initialization, and the fields themselves are reached via structured
+// bindings. Tuple-like types (std::tuple, std::pair, std::array) are used as-is.
+namespace apex::detail::sqlite {
+
+struct any final {
+  template <class T> operator T () const;
+};
+
+template <class T>
+concept tuple_like = requires { std::tuple_size<T>::value; };
+
+template <class T, class... Args>
+concept initializable_from = requires { T { std::declval<Args>()... }; };
+
+template <class T, class... Args>
+constexpr size_t arity () noexcept {
+  if constexpr (initializable_from<T, Args..., any>) { return arity<T, Args..., any>(); }
+  else { return sizeof...(Args); }
+}
+
+template <class T>
+concept fields = tuple_like<T> or (std::is_aggregate_v<T> and arity<T>() > 0);
+
+template <class T> struct field_count : std::integral_constant<size_t, arity<T>()> { };
+template <tuple_like T> struct field_count<T> : std::tuple_size<T> { };
+
+template <class T>
+inline constexpr auto field_count_v = field_count<remove_cvref_t<T>>::value;
+
+// Returns a std::tuple of references to each field of the given object.
+template <class T> requires fields<remove_cvref_t<T>>
+constexpr auto tie (T&& object) noexcept {
+  constexpr auto count = field_count_v<T>;
+  static_assert(count <= 16, "aggregates with more than 16 fields are not supported");
+  if constexpr (tuple_like<remove_cvref_t<T>>) {
+    return std::apply([] (auto&... xs) noexcept { return std::tie(xs...); }, object);
+  } else if constexpr (count == 1) {
+    auto& [a] = object;
+    return std::tie(a);
+  } else if constexpr (count == 2) {
+    auto& [a, b] = object;
+    return std::tie(a, b);
+  } else if constexpr (count == 3) {
+    auto& [a, b, c] = object;
+    return std::tie(a, b, c);
+  } else if constexpr (count == 4) {
+    auto& [a, b, c, d] = object;
+    return std::tie(a, b, c, d);
+  } else if constexpr (count == 5) {
+    auto& [a, b, c, d, e] = object;
+    return std::tie(a, b, c, d, e);
+  } else if constexpr (count == 6) {
+    auto& [a, b, c, d, e, f] = object;
+    return std::tie(a, b, c, d, e, f);
+  } else if constexpr (count == 7) {
+    auto& [a, b, c, d, e, f, g] = object;
+    return std::tie(a, b, c, d, e, f, g);
+  } else if constexpr (count == 8) {
+    auto& [a, b, c, d, e, f, g, h] = object;
+    return std::tie(a, b, c, d, e, f, g, h);
+  } else if constexpr (count == 9) {
+    auto& [a, b, c, d, e, f, g, h, i] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i);
+  } else if constexpr (count == 10) {
+    auto& [a, b, c, d, e, f, g, h, i, j] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j);
+  } else if constexpr (count == 11) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j, k);
+  } else if constexpr (count == 12) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j, k, l);
+  } else if constexpr (count == 13) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m);
+  } else if constexpr (count == 14) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n);
+  } else if constexpr (count == 15) {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o);
+  } else {
+    auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p] = object;
+    return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p);
+  }
+}
+
+} /* namespace apex::detail::sqlite */
+
+#endif /* APEX_DETAIL_SQLITE_FIELDS_HPP */
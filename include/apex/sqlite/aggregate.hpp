@@ -0,0 +1,133 @@
+#ifndef APEX_SQLITE_AGGREGATE_HPP
+#define APEX_SQLITE_AGGREGATE_HPP
+
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/context.hpp>
+
+#include <string_view>
+#include <concepts>
+#include <memory>
+#include <new>
+
+namespace apex::detail::sqlite {
+
+using ::apex::sqlite::connection;
+using ::apex::sqlite::context;
+using ::apex::sqlite::pure;
+
+template <class S>
+concept accumulator = std::default_initializable<S> and requires (S& state, context& ctx) {
+  state.step(ctx);
+  state.finalize(ctx);
+};
+
+template <class S>
+concept window = accumulator<S> and requires (S& state, context& ctx) {
+  state.inverse(ctx);
+};
+
+struct aggregator final {
+  using call_type = auto (*)(context&) -> void;
+
+  call_type step;
+  /* Only set for window functions */
+  call_type inverse;
+  call_type value;
+  call_type final;
+};
+
+// Registers the callbacks, which must outlive the connection.
+void aggregate (connection&, std::string_view, ptrdiff_t, pure, aggregator const&) noexcept(false);
+
+/* The aggregate context starts out zeroed, so live is false until the state is constructed */
+template <class S>
+struct slot final {
+  alignas(S) byte storage[sizeof(S)];
+  bool live;
+};
+
+template <class S>
+slot<S>& claim (context& ctx) noexcept(false) {
+  static_assert(alignof(S) <= 8, "sqlite only aligns aggregate contexts to 8 bytes");
+  auto item = static_cast<slot<S>*>(operator new(sizeof(slot<S>), ctx));
+  if (not item->live) {
+    ::new (static_cast<void*>(item->storage)) S { };
+    item->live = true;
+  }
+  return *item;
+}
+
+template <class S>
+S& state (context& ctx) noexcept(false) {
+  return *std::launder(reinterpret_cast<S*>(claim<S>(ctx).storage));
+}
+
+template <accumulator S>
+void finish (context& ctx) noexcept(false) {
+  struct release final {
+    ~release () noexcept {
+      std::destroy_at(std::launder(reinterpret_cast<S*>(this->item.storage)));
+      this->item.live = false;
+    }
+    slot<S>& item;
+  } const guard { claim<S>(ctx) };
+  std::launder(reinterpret_cast<S*>(guard.item.storage))->finalize(ctx);
+}
+
+template <accumulator S>
+inline constexpr aggregator callbacks {
+  [] (context& ctx) { state<S>(ctx).step(ctx); },
+  nullptr,
+  nullptr,
+  finish<S>,
+};
+
+template <window S>
+inline constexpr aggregator callbacks<S> {
+  [] (context& ctx) { state<S>(ctx).step(ctx); },
+  [] (context& ctx) { state<S>(ctx).inverse(ctx); },
+  [] (context& ctx) { state<S>(ctx).finalize(ctx); },
+  finish<S>,
+};
+
+} /* namespace apex::detail::sqlite */
+
+namespace apex::sqlite {
+
+/** @brief Registers S as an aggregate function.
+ *
+ * A fresh S is value-initialized inside sqlite's aggregate context for each
+ * group, the first time a row reaches it. Each row is then handed to
+ * `step(context&)`, whose arguments are read with context::operator[], and
+ * `finalize(context&)` sets the result once the group is done, after which
+ * the state is destroyed.
+ *
+ * If S also has `inverse(context&)`, it is registered as a window function.
+ * inverse removes a row that has left the window, and finalize is then also
+ * called each time the window's current value is needed, so it must leave
+ * the state as it found it. This lets a sliding window update its state as
+ * rows come and go, rather than recomputing it from scratch for every row.
+ *
+ *   struct total final {
+ *     void step (context& ctx) { this->sum += static_cast<i64>(ctx[0]); }
+ *     void inverse (context& ctx) { this->sum -= static_cast<i64>(ctx[0]); }
+ *     void finalize (context& ctx) { ctx = this->sum; }
+ *     i64 sum;
+ *   };
+ *
+ *   aggregate<total>(conn, "total", 1, pure::yes);
+ *   // SELECT total(x) OVER (ORDER BY t ROWS 9 PRECEDING) FROM ...
+ */
+template <::apex::detail::sqlite::accumulator S>
+void aggregate (connection& conn, std::string_view name, ptrdiff_t argc, pure deterministic) noexcept(false) {
+  ::apex::detail::sqlite::aggregate(conn, name, argc, deterministic, ::apex::detail::sqlite::callbacks<S>);
+}
+
+template <::apex::detail::sqlite::accumulator S>
+void aggregate (connection& conn, std::string_view name, ptrdiff_t argc) noexcept(false) {
+  aggregate<S>(conn, name, argc, pure::no);
+}
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_AGGREGATE_HPP */
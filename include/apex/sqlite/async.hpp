@@ -0,0 +1,141 @@
+#ifndef APEX_SQLITE_ASYNC_HPP
+#define APEX_SQLITE_ASYNC_HPP
+
+#include <apex/sqlite/executor.hpp>
+#include <apex/sqlite/query.hpp>
+#include <apex/core/task.hpp>
+
+#include <type_traits>
+#include <functional>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <string>
+#include <tuple>
+
+namespace apex::sqlite {
+
+/** Calls the function on the executor's thread, and then returns to the
+ * awaiting coroutine through executor::dispatch. Exceptions are carried
+ * across, and rethrown from the co_await expression.
+ */
+template <class F>
+task<std::invoke_result_t<F&>> run (executor& exec, F function) {
+  using result_type = std::invoke_result_t<F&>;
+  std::exception_ptr error;
+  co_await exec.schedule();
+  if constexpr (std::is_void_v<result_type>) {
+    try { function(); }
+    catch (...) { error = std::current_exception(); }
+    co_await exec.dispatch();
+    if (error) { std::rethrow_exception(error); }
+  } else {
+    std::optional<result_type> result;
+    try { result.emplace(function()); }
+    catch (...) { error = std::current_exception(); }
+    co_await exec.dispatch();
+    if (error) { std::rethrow_exception(error); }
+    co_return std::move(*result);
+  }
+}
+
+inline task<> execute (executor& exec, connection& conn, std::string sql) {
+  co_await run(exec, [&conn, &sql] { execute(conn, sql); });
+}
+
+/** @brief Rows of a query, fetched on an executor in batches.
+ *
+ * Each call to next() hands back one row, and only goes to the executor when
+ * the current batch has run out, so the cost of the round trip is spread
+ * over the batch. Rows are decoded on the executor, which means T must own
+ * its data (i.e., std::string rather than std::string_view).
+ *
+ * The statement is prepared lazily, and released on the executor once the
+ * rows run out, or when the stream is destroyed. Both the executor and the
+ * connection must outlive the stream, and next() must not be called again
+ * until the previous call has finished.
+ */
+template <class T>
+struct stream final {
+  using binder_type = std::function<void(statement&)>;
+
+  stream (executor& exec, connection& conn, std::string sql, binder_type binder, size_t batch) noexcept :
+    exec { exec },
+    conn { conn },
+    sql { std::move(sql) },
+    binder { std::move(binder) },
+    batch { batch ? batch : 1 }
+  { }
+
+  stream (stream&&) = default;
+  stream (stream const&) = delete;
+  ~stream () noexcept {
+    if (not this->stmt) { return; }
+    auto lease = std::make_shared<cache::lease>(std::move(*this->stmt));
+    try { this->exec.get().post([lease] { }); }
+    catch (...) { }
+  }
+
+  stream& operator = (stream const&) = delete;
+
+  task<std::optional<T>> next () {
+    if (this->index == this->buffer.size() and not this->finished) {
+      co_await run(this->exec.get(), [this] { this->fill(); });
+    }
+    if (this->index == this->buffer.size()) { co_return std::nullopt; }
+    co_return std::move(this->buffer[this->index++]);
+  }
+
+private:
+  /* Runs on the executor */
+  void fill () noexcept(false) {
+    this->buffer.clear();
+    this->index = 0;
+    if (not this->stmt) {
+      this->stmt.emplace(this->conn.get().prepare(this->sql));
+      ::apex::detail::sqlite::check<T>(**this->stmt);
+      if (this->binder) { this->binder(**this->stmt); }
+      this->current = row { **this->stmt };
+    }
+    while (this->current != row { } and this->buffer.size() < this->batch) {
+      this->buffer.push_back(this->current.template as<T>());
+      ++this->current;
+    }
+    if (this->current == row { }) {
+      this->finished = true;
+      this->stmt.reset();
+    }
+  }
+
+  std::reference_wrapper<executor> exec;
+  std::reference_wrapper<connection> conn;
+  std::string sql;
+  binder_type binder;
+  size_t batch;
+
+  std::optional<cache::lease> stmt;
+  row current;
+  std::vector<T> buffer;
+  size_t index { };
+  bool finished { false };
+};
+
+/** Like query, but the statement is stepped on the executor. Arguments are
+ * copied, and bound once the first batch is fetched.
+ */
+template <class T, class... Args> requires ::apex::detail::sqlite::fields<T>
+stream<T> query (executor& exec, connection& conn, std::string sql, size_t batch, Args... args) {
+  auto binder = [args = std::make_tuple(std::move(args)...)] (statement& stmt) {
+    std::apply([&stmt] (auto const&... items) {
+      ptrdiff_t idx = 0;
+      (bind(stmt, ++idx, items), ...);
+    }, args);
+  };
+  return stream<T> { exec, conn, std::move(sql), std::move(binder), batch };
+}
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_ASYNC_HPP */
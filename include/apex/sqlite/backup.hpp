@@ -1,10 +1,12 @@
 #ifndef APEX_SQLITE_BACKUP_HPP
 #define APEX_SQLITE_BACKUP_HPP
 
-#include <apex/mixin/iterator.hpp>
+#include <apex/core/functional.hpp>
+#include <apex/core/iterable.hpp>
 #include <apex/sqlite/memory.hpp>
 #include <apex/core/string.hpp>
 
+#include <chrono>
 #include <memory>
 
 struct sqlite3_backup;
@@ -13,27 +15,94 @@ namespace apex::sqlite {
 
 struct connection;
 
-struct backup final : private shared_handle<sqlite3_backup>/*, private mixin::iterator<backup>*/ {
+/** @brief An online backup from one database into another.
+ *
+ * Pages are copied in steps, and the source is only locked for the duration
+ * of a step, so writers can make progress between them. If the source is
+ * written through another connection mid-backup, sqlite restarts the copy
+ * on the next step.
+ *
+ * A backup is also an iterator over its own progress, where each increment
+ * copies the next step of pages. A default constructed backup is finished,
+ * and marks the end of a range.
+ */
+struct backup final : private shared_handle<sqlite3_backup> {
+  using progress_type = function_ref<void(backup const&)>;
+  using duration = std::chrono::nanoseconds;
+  using difference_type = ptrdiff_t;
+  using value_type = backup;
+
   using resource_type::get;
 
+  /** Pacing for run(). Each step copies `pages` pages, and is followed by
+   * a `pause` (a zero pause yields instead). A step that finds the source
+   * busy or locked is retried after the same pause, until `patience` has
+   * passed without any progress, at which point the error is thrown.
+   */
+  struct throttle final {
+    ptrdiff_t pages { 64 };
+    duration pause { };
+    duration patience { std::chrono::seconds { 30 } };
+  };
+
   backup (connection&, zstring_view, connection const&, zstring_view) noexcept(false);
-  backup () = delete;
+  backup (connection&, connection const&) noexcept(false);
+  backup (backup const&) = default;
+  backup (backup&&) = default;
+  backup () noexcept = default;
 
   backup& operator = (backup const&) = default;
   backup& operator = (backup&&) = default;
 
   void swap (backup&) noexcept;
 
-  backup const& read_from () noexcept;
+  /** Copies up to the given number of pages, or all of them if negative.
+   * Returns false once every page has been copied. A busy or locked source
+   * is not an error here, and simply copies nothing.
+   */
+  bool step (ptrdiff_t) noexcept(false);
+
+  void run (throttle const&, progress_type) noexcept(false);
+  void run (throttle const&) noexcept(false);
+
+  /* Steps once, and then once per increment. The last step that copies
+   * pages is still visited, and the increment after it reaches the end.
+   */
+  iterable<backup> steps (ptrdiff_t) noexcept(false);
+
+  backup const& read_from () const noexcept;
 
+  /* In pages */
   ptrdiff_t distance_to (backup const&) const noexcept;
-  void next () noexcept;
+  void next () noexcept(false);
 
   bool equals (backup const&) const noexcept;
 
+  backup const& operator * () const noexcept { return this->read_from(); }
+  backup& operator ++ () noexcept(false) {
+    this->next();
+    return *this;
+  }
+
+  bool operator == (backup const& that) const noexcept { return this->equals(that); }
+  bool operator != (backup const& that) const noexcept { return not this->equals(that); }
+
+  bool is_finished () const noexcept;
+
   ptrdiff_t remaining () const noexcept;
   ptrdiff_t copied () const noexcept;
   ptrdiff_t total () const noexcept;
+
+private:
+  /* steps sqlite's backup, returns the result for anything but an error */
+  int advance (ptrdiff_t) noexcept(false);
+
+  /* Copies share the sqlite3_backup, so whether it has reached the end is
+   * shared too. Whether a copy has been advanced past that is its own.
+   */
+  std::shared_ptr<bool> done;
+  ptrdiff_t stride { -1 };
+  bool finished { true };
 };
 
 } /* namespace apex::sqlite */
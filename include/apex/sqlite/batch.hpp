@@ -0,0 +1,103 @@
+#ifndef APEX_SQLITE_BATCH_HPP
+#define APEX_SQLITE_BATCH_HPP
+
+#include <apex/sqlite/column.hpp>
+#include <apex/memory/view.hpp>
+#include <apex/core/span.hpp>
+
+#include <string_view>
+#include <string>
+#include <vector>
+
+struct sqlite3_stmt;
+
+namespace apex::sqlite {
+
+struct statement;
+
+/** @brief A column-major block of rows fetched from a statement.
+ *
+ * Each column is stored according to the affinity of its declared type.
+ * INTEGER columns are stored as a contiguous array of i64, and REAL columns
+ * as a contiguous array of f64. TEXT and BLOB columns are appended to a
+ * single arena, with size() + 1 offsets into it. Every column also has a
+ * bitmap where a set bit marks a NULL. The slot for a NULL is zero, or an
+ * empty string.
+ *
+ * NUMERIC columns may hold both integers and reals, so they fill both
+ * arrays, along with a bitmap where a set bit marks a value stored as an
+ * INTEGER. For those rows the i64 is exact (even past 2^53), and for the
+ * rest the f64 is. Columns without a declared type (e.g., expressions) take
+ * their affinity from the type of their value in the first row, and a NULL
+ * there makes them NUMERIC.
+ *
+ * The buffers are only ever grown, so once a batch has seen its largest
+ * fetch, further fetches do not allocate.
+ */
+struct batch final {
+  batch (batch const&) = delete;
+  batch (batch&&) noexcept = default;
+  batch () noexcept = default;
+
+  batch& operator = (batch const&) = delete;
+  batch& operator = (batch&&) noexcept = default;
+
+  size_t columns () const noexcept;
+  size_t size () const noexcept;
+  bool empty () const noexcept;
+
+  affinity type (size_t) const noexcept;
+
+  span<i64 const> integers (size_t) const noexcept;
+  span<f64 const> reals (size_t) const noexcept;
+
+  span<u32 const> offsets (size_t) const noexcept;
+  std::string_view arena (size_t) const noexcept;
+  std::string_view text (size_t, size_t) const noexcept;
+
+  span<u64 const> nulls (size_t) const noexcept;
+  size_t null_count (size_t) const noexcept;
+  bool is_null (size_t, size_t) const noexcept;
+
+  /* Only NUMERIC columns have this bitmap */
+  span<u64 const> integral (size_t) const noexcept;
+  bool is_integral (size_t, size_t) const noexcept;
+
+  /* Forgets the statement last fetched from, but keeps all buffers */
+  void clear () noexcept;
+
+private:
+  friend size_t fetch (statement&, batch&, size_t) noexcept(false);
+
+  struct field final {
+    affinity kind;
+    std::vector<i64> integers;
+    std::vector<f64> reals;
+    std::vector<u32> offsets;
+    std::vector<u64> nulls;
+    std::vector<u64> integral;
+    std::string arena;
+    bool deferred;
+  };
+
+  std::vector<field> fields;
+  view_ptr<sqlite3_stmt> source;
+  size_t rows { };
+  /* The statement's run counter, as of the last row read */
+  int run { };
+  bool finished { };
+};
+
+/** @brief Steps the statement up to count times, replacing the contents of
+ * the batch with the rows read.
+ *
+ * Returns the number of rows read. Once the statement is done, the next
+ * fetch from it returns 0, rather than letting sqlite restart it. Fetching
+ * again after that starts a new run, and a run started (or a statement
+ * stepped) anywhere else is picked up where it is.
+ */
+size_t fetch (statement&, batch&, size_t) noexcept(false);
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_BATCH_HPP */
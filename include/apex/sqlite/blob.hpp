@@ -1,31 +1,112 @@
 #ifndef APEX_SQLITE_BLOB_HPP
 #define APEX_SQLITE_BLOB_HPP
 
+#include <apex/core/iterable.hpp>
+#include <apex/core/prelude.hpp>
+#include <apex/core/string.hpp>
+#include <apex/core/span.hpp>
+
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/memory.hpp>
+
+#include <memory>
+
 struct sqlite3_blob;
 
 namespace apex::sqlite {
 
-// TODO: use a default_delete from within apex
-struct blob final {
-  using resource_type = std::unique_ptr<sqlite3_blob>;
-  using pointer = resource_type::pointer;
+template <>
+struct default_delete<sqlite3_blob> {
+  void operator () (sqlite3_blob*) noexcept;
+};
+
+struct statement;
+
+/* Where blob::seek measures its offset from */
+enum class whence { begin, current, end };
+
+/* Binds a blob of the given size filled with zeroes, without allocating it */
+struct zeroblob final {
+  i64 size;
+};
+
+void bind (statement const&, ptrdiff_t, zeroblob) noexcept(false);
+
+/** @brief Incremental I/O on a single BLOB or TEXT value, in place.
+ *
+ * Reads and writes go straight to the database pages, so a value of any size
+ * can be served through a fixed buffer. Positioned reads and writes (those
+ * taking an offset) leave the position alone, while the rest advance it, as
+ * with a file. Reading past the end is not an error, and only fills part of
+ * the buffer.
+ *
+ * A blob cannot change the size of its value, so writing a new value is done
+ * by inserting a zeroblob of the final size, and then writing into it.
+ * reopen() moves the handle to another row of the same column, which is far
+ * cheaper than opening a new handle for each row.
+ *
+ * If the row is changed or deleted by anything other than this blob, the
+ * handle expires, and every operation but reopen() throws
+ * error::operation_aborted.
+ */
+struct blob final : private unique_handle<sqlite3_blob> {
+  struct chunk;
+
+  using resource_type::get;
 
-  static blob extend (column const&) noexcept(false);
-  static blob open (column const&) noexcept(false);
+  blob (connection&, zstring_view, zstring_view, zstring_view, i64, access) noexcept(false);
+  blob (connection&, zstring_view, zstring_view, i64, access) noexcept(false);
+  blob (connection&, zstring_view, zstring_view, i64) noexcept(false);
+  blob (blob&&) noexcept = default;
+  blob () = delete;
+
+  blob& operator = (blob&&) noexcept = default;
 
   void swap (blob&) noexcept;
 
-  pointer get () const noexcept;
+  /* Moves to the same column of another row, and rewinds */
+  void reopen (i64) noexcept(false);
+
+  /* Returns the part of the buffer that was filled */
+  span<byte> read (span<byte>, i64) const noexcept(false);
+  span<byte> read (span<byte>) noexcept(false);
+
+  /* Throws error::argument_out_of_range if the write would run past the end */
+  void write (span<byte const>, i64) noexcept(false);
+  void write (span<byte const>) noexcept(false);
+
+  /* Returns the new position, which must lie within [0, size()] */
+  i64 seek (i64, whence) noexcept(false);
+  i64 tell () const noexcept;
+  i64 size () const noexcept;
+
+  /* Reads the rest of the value one buffer at a time, starting at the
+   * current position. Each chunk refers to the buffer, and is overwritten by
+   * the next one.
+   */
+  iterable<chunk> chunks (span<byte>) noexcept(false);
+
+private:
+  i64 position { };
+};
+
+struct blob::chunk final {
+  using difference_type = ptrdiff_t;
+  using value_type = span<byte const>;
+
+  chunk (blob&, span<byte>) noexcept(false);
+  chunk () noexcept = default;
+
+  value_type operator * () const noexcept { return this->current; }
+  chunk& operator ++ () noexcept(false);
 
-  void write (span<byte const> const&) noexcept(false);
-  void read (span<byte>&) noexcept(false);
+  bool operator == (chunk const&) const noexcept;
+  bool operator != (chunk const& that) const noexcept { return not (*this == that); }
 
-  // TODO: add from/whence and i64 as parameters
-  void seek ();
-  i64 tell ();
-  i64 size () const noexcept(false);
 private:
-  resource_type handle;
+  blob* source { };
+  span<byte> buffer;
+  value_type current;
 };
 
 } /* namespace apex::sqlite */
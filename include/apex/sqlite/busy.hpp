@@ -0,0 +1,77 @@
+#ifndef APEX_SQLITE_BUSY_HPP
+#define APEX_SQLITE_BUSY_HPP
+
+#include <apex/sqlite/histogram.hpp>
+#include <apex/sync/backoff.hpp>
+
+#include <atomic>
+
+namespace apex::sqlite {
+
+struct connection;
+
+/** @brief Retries a locked database with exponential backoff.
+ *
+ * Replaces the connection's busy handler (and any busy timeout) for as long
+ * as it lives. Each time sqlite finds a database locked, it retries with the
+ * same spin, then yield, then sleep backoff as concurrency::spin_mutex, up to
+ * `budget` after the lock was first found busy. sqlite3_busy_timeout sleeps
+ * in fixed steps of up to 100ms, which leaves a waiting writer asleep long
+ * after the lock was freed. Once the budget runs out, the statement fails
+ * with error::resource_busy as before.
+ *
+ * The handler runs on the connection's thread, and the statistics may be read
+ * from any thread.
+ */
+struct busy final {
+  using duration = concurrency::backoff::duration;
+  using options = concurrency::backoff::options;
+
+  struct statistics final {
+    /* How long each wait took, until its last retry (or until it gave up) */
+    histogram waits;
+    /* Lock attempts that found the database busy */
+    std::atomic<u64> contended { };
+    std::atomic<u64> retries { };
+    /* Waits that ran out of budget */
+    std::atomic<u64> timeouts { };
+  };
+
+  /* Lock retries go through sqlite's VFS, so they spin much less than a mutex */
+  static constexpr options defaults {
+    .spins = 2,
+    .yields = 2,
+    .floor = std::chrono::microseconds { 20 },
+    .ceiling = std::chrono::milliseconds { 5 },
+  };
+
+  busy (connection&, duration, options) noexcept(false);
+  busy (connection&, duration) noexcept(false);
+  busy (busy const&) = delete;
+  busy () = delete;
+  ~busy () noexcept;
+
+  busy& operator = (busy const&) = delete;
+
+  statistics const& stats () const noexcept;
+
+private:
+  using time_point = concurrency::backoff::clock::time_point;
+
+  static int retry (void*, int) noexcept;
+  bool operator () (int) noexcept;
+
+  connection& guarded;
+  concurrency::backoff wait;
+  duration budget;
+  time_point started;
+  time_point deadline;
+  /* When the current wait last let sqlite retry */
+  time_point granted;
+  bool waiting { false };
+  statistics counters;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_BUSY_HPP */
@@ -0,0 +1,100 @@
+#ifndef APEX_SQLITE_CACHE_HPP
+#define APEX_SQLITE_CACHE_HPP
+
+#include <apex/sqlite/statement.hpp>
+#include <apex/core/prelude.hpp>
+
+#include <unordered_map>
+#include <string_view>
+#include <string>
+#include <list>
+
+namespace apex::sqlite {
+
+struct connection;
+
+/** @brief A bounded LRU cache of prepared statements, keyed by SQL text.
+ *
+ * Statements are checked out via acquire, and are returned to the cache (reset
+ * and with their bindings cleared) when the lease handed back is destroyed.
+ * A statement that is currently checked out is never evicted. Asking for the
+ * same text while it is checked out (e.g., from inside a user defined
+ * function) prepares a second, uncached, copy.
+ *
+ * Only text consisting of a single statement is cached. Scripts are still
+ * prepared one statement at a time, and the remaining text is available via
+ * lease::tail.
+ *
+ * @note Like the connection that owns it, a cache is *not* thread safe.
+ */
+struct cache final {
+  struct statistics final {
+    u64 hits;
+    u64 misses;
+    u64 evictions;
+  };
+
+  struct lease;
+
+  explicit cache (size_t) noexcept;
+  cache (cache const&) = delete;
+  cache (cache&&) noexcept = default;
+  cache () noexcept;
+
+  cache& operator = (cache const&) = delete;
+  cache& operator = (cache&&) noexcept = default;
+
+  lease acquire (connection&, std::string_view) noexcept(false);
+
+  void capacity (size_t) noexcept;
+  size_t capacity () const noexcept;
+  size_t size () const noexcept;
+
+  statistics const& stats () const noexcept;
+
+  /* Finalizes every statement that is not currently checked out */
+  void clear () noexcept;
+
+private:
+  struct node final {
+    std::string sql;
+    statement stmt;
+    bool busy;
+  };
+  using iterator = std::list<node>::iterator;
+
+  void release (iterator) noexcept;
+  void trim () noexcept;
+
+  std::unordered_map<std::string_view, iterator> index;
+  std::list<node> entries;
+  statistics counters { };
+  size_t limit;
+};
+
+struct cache::lease final {
+  lease (lease const&) = delete;
+  lease (lease&&) noexcept;
+  ~lease () noexcept;
+
+  lease& operator = (lease const&) = delete;
+  lease& operator = (lease&&) = delete;
+
+  statement& operator * () const noexcept;
+  statement* operator -> () const noexcept;
+
+  /* Any text following the statement that was prepared */
+  std::string_view tail () const noexcept;
+
+private:
+  friend cache;
+  lease (cache&, iterator, std::string_view) noexcept;
+
+  cache* owner;
+  iterator entry;
+  std::string_view rest;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_CACHE_HPP */
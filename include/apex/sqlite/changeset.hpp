@@ -0,0 +1,103 @@
+#ifndef APEX_SQLITE_CHANGESET_HPP
+#define APEX_SQLITE_CHANGESET_HPP
+
+#include <apex/sqlite/memory.hpp>
+#include <apex/sqlite/table.hpp>
+#include <apex/core/prelude.hpp>
+#include <apex/core/span.hpp>
+
+#include <string_view>
+#include <vector>
+#include <string>
+
+struct sqlite3_session;
+
+namespace apex::sqlite {
+
+template <>
+struct default_delete<sqlite3_session> {
+  void operator () (sqlite3_session*) noexcept;
+};
+
+struct connection;
+
+/** @brief The rows one or more transactions changed, in sqlite's changeset format.
+ *
+ * Each changed row is recorded once, with its primary key and the columns
+ * that changed (along with their original values, so that conflicts can be
+ * detected where the changeset is applied). A changeset is only as large as
+ * the rows it touches, which makes it far cheaper to ship to a follower than
+ * the database file. Consecutive changesets can be combined, which merges
+ * changes to the same row into one.
+ */
+struct changeset final {
+  changeset (std::vector<byte>) noexcept;
+  changeset () noexcept = default;
+
+  span<byte const> data () const noexcept;
+  size_t size () const noexcept;
+  bool empty () const noexcept;
+
+  changeset& operator += (changeset const&) noexcept(false);
+
+private:
+  std::vector<byte> bytes;
+};
+
+/** @brief Records the changes made through a connection, for replication.
+ *
+ * Only tables with a declared PRIMARY KEY are recorded, as that is how rows
+ * are matched up on followers. Each call to flush returns everything that
+ * has been committed since the last one, so calling it after every
+ * transaction yields one changeset per transaction:
+ *
+ *   recorder changes { leader };
+ *   {
+ *     transaction tx { leader, behavior::immediate };
+ *     execute(leader, "UPDATE jobs SET state = 'done' WHERE id = 7");
+ *     tx.commit();
+ *   }
+ *   apply(follower, changes.flush(), conflict::replace);
+ *
+ * Requires sqlite to be built with SQLITE_ENABLE_SESSION and
+ * SQLITE_ENABLE_PREUPDATE_HOOK.
+ */
+struct recorder final : protected unique_handle<sqlite3_session> {
+  using resource_type::get;
+
+  /* Records every table in the schema, including those created later */
+  recorder (connection&, std::string_view) noexcept(false);
+  explicit recorder (connection&) noexcept(false);
+  recorder () = delete;
+
+  /* Records only the given tables from then on, discarding any changes
+   * recorded before the first call */
+  void attach (std::string_view) noexcept(false);
+
+  bool empty () const noexcept;
+
+  /* Throws error::inappropriate_operation inside a transaction */
+  changeset flush () noexcept(false);
+
+private:
+  void start () noexcept(false);
+
+  connection& handle;
+  std::string schema;
+  std::vector<std::string> tables;
+};
+
+/** Applies a changeset inside a savepoint, resolving conflicts as follows:
+ *
+ *  - ignore: a conflicting change is skipped.
+ *  - replace: the change overwrites the row that conflicts with it, and a
+ *    change to a row that is missing is skipped. Changes that would violate
+ *    a constraint still fail.
+ *  - rollback, fail, and abort: the first conflict undoes the entire
+ *    changeset, which throws error::operation_aborted.
+ */
+void apply (connection&, changeset const&, conflict) noexcept(false);
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_CHANGESET_HPP */
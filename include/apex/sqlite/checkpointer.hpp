@@ -0,0 +1,93 @@
+#ifndef APEX_SQLITE_CHECKPOINTER_HPP
+#define APEX_SQLITE_CHECKPOINTER_HPP
+
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/histogram.hpp>
+
+#include <condition_variable>
+#include <system_error>
+#include <filesystem>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <array>
+#include <mutex>
+
+namespace apex::sqlite {
+
+/** @brief Moves WAL checkpoints off the writer's commit path.
+ *
+ * The database must already be in WAL mode. The watched connection's WAL
+ * hook is replaced, which also disables its automatic checkpoints until the
+ * checkpointer is destroyed. Commits only record the size of the WAL, and
+ * wake a background thread (with its own connection) once it passes the
+ * passive threshold. The background thread checkpoints passively, escalating to
+ * restart and then truncate as the WAL keeps growing, which is what bounds
+ * it when readers keep a passive checkpoint from finishing. Commits past the
+ * truncate threshold wait for that checkpoint, so the writer cannot starve it.
+ *
+ * The checkpointer must be created and destroyed on the thread that uses the
+ * watched connection, and the connection must outlive it. Restart and
+ * truncate checkpoints briefly take the write lock, so the watched connection
+ * needs a busy timeout.
+ */
+struct checkpointer final {
+  using duration = std::chrono::nanoseconds;
+
+  /* In WAL frames (i.e., pages) */
+  struct thresholds final {
+    ptrdiff_t passive { 1000 };
+    ptrdiff_t restart { 16000 };
+    ptrdiff_t truncate { 64000 };
+    /* how long restart and truncate checkpoints may wait on readers */
+    duration patience { std::chrono::milliseconds { 100 } };
+  };
+
+  /* Throws error::inappropriate_operation unless the database is in WAL mode */
+  checkpointer (connection&, std::filesystem::path const&, thresholds) noexcept(false);
+  checkpointer (connection&, std::filesystem::path const&) noexcept(false);
+  checkpointer (checkpointer const&) = delete;
+  checkpointer () = delete;
+  ~checkpointer () noexcept;
+
+  checkpointer& operator = (checkpointer const&) = delete;
+
+  /* Asks the background thread for a checkpoint of (at least) this kind */
+  void request (checkpoint) noexcept;
+
+  histogram const& latency (checkpoint) const noexcept;
+
+  /* WAL size as of the last commit */
+  ptrdiff_t frames () const noexcept;
+  /* The last error a checkpoint ran into, other than busy */
+  std::error_code failure () const noexcept;
+
+private:
+  static int notify (void*, sqlite3*, char const*, int) noexcept;
+  void run () noexcept;
+
+  connection& watched;
+  connection background;
+  thresholds limits;
+  /* The watched connection's wal_autocheckpoint, restored on destruction */
+  int previous { };
+
+  std::array<histogram, 4> latencies;
+  std::atomic<ptrdiff_t> size { };
+  std::atomic<int> status { };
+  std::atomic<bool> pending { };
+
+  std::condition_variable finished;
+  std::condition_variable wake;
+  std::mutex mutex;
+  checkpoint requested { checkpoint::passive };
+  u64 completed { };
+  bool running { false };
+  bool stopping { false };
+
+  std::thread worker;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_CHECKPOINTER_HPP */
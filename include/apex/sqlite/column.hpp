@@ -12,11 +12,15 @@ namespace apex::sqlite {
 using std::string_view;
 struct value;
 
+/* The type affinity of a column, as derived from its declared type */
+enum class affinity { blob, text, numeric, integer, real };
+
 // TODO: add mixin::iterator<column>
 struct column final : private view_handle<sqlite3_stmt> {
   using resource_type::resource_type;
   using resource_type::get;
 
+  column (pointer, ptrdiff_t) noexcept;
   column () = delete;
 
   friend void swap (column&, column&) noexcept;
@@ -39,6 +43,7 @@ struct column final : private view_handle<sqlite3_stmt> {
 
   string_view collation () const noexcept;
   ptrdiff_t index () const noexcept;
+  affinity type () const noexcept;
 
   // TODO: add casting to values
 
@@ -0,0 +1,85 @@
+#ifndef APEX_SQLITE_COLUMNAR_HPP
+#define APEX_SQLITE_COLUMNAR_HPP
+
+#include <apex/sqlite/table.hpp>
+
+#include <string_view>
+#include <variant>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace apex::sqlite {
+
+/** @brief A read-only virtual table over contiguous, in-memory columns.
+ *
+ * Each column is a single vector of i64, f64, or std::string, and a row's
+ * rowid is its position. Columns are split into blocks of `block` rows, each
+ * of which keeps a zone map (where its smallest and largest values are), so
+ * a scan skips every block that a constraint rules out, and checks the rest
+ * of them a block at a time. A column can also be sorted, which keeps its
+ * positions in value order for equality and range lookups, and lets an
+ * ORDER BY on that column skip sqlite's sort.
+ *
+ * Constraints only narrow the scan. sqlite still checks every row that is
+ * returned, so type conversions and collations keep their usual meaning, and
+ * a constraint whose value has the wrong type for its column is skipped.
+ * TEXT constraints are only used with the BINARY collation.
+ *
+ * Columns are added (and sorted) before the table is plugged in. After that,
+ * the instances sqlite creates for each connection share the same data.
+ *
+ *   auto prices = std::make_shared<columnar>();
+ *   prices->add("id", std::move(ids));
+ *   prices->add("price", std::move(amounts));
+ *   prices->sort("id");
+ *   plugin(conn, "prices", prices);
+ *   execute(conn, "CREATE VIRTUAL TABLE temp.prices USING prices");
+ */
+struct columnar final : table {
+  using data_type = std::variant<
+    std::vector<i64>,
+    std::vector<f64>,
+    std::vector<std::string>
+  >;
+
+  /* Rows per zone map, and per batch a cursor evaluates at once */
+  static constexpr size_t block = 1024;
+
+  struct store;
+
+  columnar () noexcept(false);
+
+  /* Every column must have as many rows as the first one */
+  void add (std::string, data_type) noexcept(false);
+  /* Keeps the positions of the named column in value order */
+  void sort (std::string_view) noexcept(false);
+
+  size_t columns () const noexcept;
+  size_t size () const noexcept;
+
+  std::shared_ptr<table> clone () const noexcept(false) override;
+
+  void connect (std::any) noexcept(false) override;
+  void create (std::any) noexcept(false) override;
+
+  void disconnect () noexcept(false) override;
+  void destroy () noexcept(false) override;
+
+  std::shared_ptr<cursor> iterator () const noexcept(false) override;
+
+  index::output const& access (index::input const&) noexcept(false) override;
+
+  string schema () noexcept(false) override;
+  void rename (char const*) noexcept(false) override;
+
+private:
+  struct scanner;
+
+  std::shared_ptr<store> data;
+  index::output plan;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_COLUMNAR_HPP */
@@ -0,0 +1,115 @@
+#ifndef APEX_SQLITE_COMMITTER_HPP
+#define APEX_SQLITE_COMMITTER_HPP
+
+#include <apex/sqlite/pool.hpp>
+
+#include <condition_variable>
+#include <type_traits>
+#include <functional>
+#include <exception>
+#include <optional>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+namespace apex::sqlite {
+
+/** @brief Group commit for many small, independent writes.
+ *
+ * Writes are closures that take the pool's writer connection. They are
+ * queued from any number of threads, and applied by a single background
+ * thread, which wraps each batch in one BEGIN IMMEDIATE ... COMMIT, so a
+ * batch pays for a single fsync. Each closure also runs inside its own
+ * savepoint, so one that throws only rolls back its own changes, and its
+ * exception is handed to its own future.
+ *
+ * A batch is closed once it holds `writes` closures, or `delay` after the
+ * first of them was taken. A zero delay (the default) takes whatever queued
+ * up while the previous batch was committing, which is usually the best
+ * trade between latency and throughput.
+ *
+ * Futures are only ready once their batch has committed. If the commit
+ * fails, every future in the batch receives the error, even if its closure
+ * returned. Closures must not begin, commit, or roll back transactions of
+ * their own. The writer is leased from the pool once per batch, and the pool
+ * must outlive the committer. Destroying the committer applies everything
+ * already queued.
+ */
+struct committer final {
+  using duration = std::chrono::nanoseconds;
+
+  struct budget final {
+    size_t writes { 1024 };
+    duration delay { };
+  };
+
+  committer (pool&, budget) noexcept(false);
+  explicit committer (pool&) noexcept(false);
+  committer (committer const&) = delete;
+  committer () = delete;
+  ~committer () noexcept;
+
+  committer& operator = (committer const&) = delete;
+
+  template <class F>
+  std::future<std::invoke_result_t<F&, connection&>> submit (F work) noexcept(false) {
+    using result_type = std::invoke_result_t<F&, connection&>;
+    struct state final {
+      F work;
+      std::promise<result_type> promise;
+      std::optional<std::conditional_t<std::is_void_v<result_type>, bool, result_type>> result;
+    };
+    auto shared = std::make_shared<state>(state { std::move(work), { }, { } });
+    auto future = shared->promise.get_future();
+    auto apply = [shared] (connection& conn) {
+      if constexpr (std::is_void_v<result_type>) {
+        shared->work(conn);
+        shared->result.emplace(true);
+      } else { shared->result.emplace(shared->work(conn)); }
+    };
+    auto settle = [shared] (std::exception_ptr error) {
+      if (error) { shared->promise.set_exception(error); }
+      else if constexpr (std::is_void_v<result_type>) { shared->promise.set_value(); }
+      else { shared->promise.set_value(std::move(*shared->result)); }
+    };
+    this->enqueue(entry { std::move(apply), std::move(settle) });
+    return future;
+  }
+
+  /* Batches committed (or failed) so far, and the closures they held */
+  u64 batches () const noexcept;
+  u64 writes () const noexcept;
+
+private:
+  struct entry final {
+    std::function<void(connection&)> apply;
+    /* Called with the closure's exception, the commit's, or null */
+    std::function<void(std::exception_ptr)> settle;
+  };
+
+  void enqueue (entry) noexcept(false);
+  void commit (std::vector<entry>&) noexcept;
+  void run () noexcept;
+
+  pool& writers;
+  budget limits;
+
+  std::atomic<u64> committed { };
+  std::atomic<u64> applied { };
+
+  std::condition_variable ready;
+  std::deque<entry> queue;
+  std::mutex mutex;
+  bool stopping { false };
+
+  std::thread worker;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_COMMITTER_HPP */
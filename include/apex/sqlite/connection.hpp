@@ -1,8 +1,11 @@
 #ifndef APEX_SQLITE_CONNECTION_HPP
 #define APEX_SQLITE_CONNECTION_HPP
 
+#include <apex/sqlite/deadline.hpp>
 #include <apex/sqlite/memory.hpp>
+#include <apex/sqlite/cache.hpp>
 #include <filesystem>
+#include <memory>
 
 //#include <apex/core/outcome.hpp>
 
@@ -18,6 +21,7 @@ struct default_delete<sqlite3> {
 struct context;
 struct table;
 
+enum class access { read_only, read_write };
 enum class checkpoint { passive, full, restart, truncate };
 enum class aggregated { step, final };
 enum class pure : bool { no, yes };
@@ -28,7 +32,12 @@ using function_t = auto (*)(context&) -> void;
 struct connection : protected unique_handle<sqlite3> {
   using resource_type::get;
 
-  // TODO: remove this once outcome<connection, std::error_code> is available
+  // TODO: remove these once outcome<connection, std::error_code> is available
+  /* Connections are opened with SQLITE_OPEN_NOMUTEX. Like std::fstream, a
+   * connection may be moved between threads, but never shared across them.
+   */
+  connection (::std::filesystem::path const&, access, std::string_view) noexcept(false);
+  connection (::std::filesystem::path const&, access) noexcept(false);
   connection (::std::filesystem::path const&) noexcept(false);
 
 //  static outcome<connection, std::error_code> temporary () noexcept;
@@ -46,6 +55,20 @@ struct connection : protected unique_handle<sqlite3> {
 
   ptrdiff_t changes () const noexcept;
   bool autocommit () const noexcept;
+
+  /* Returns a reset, cleared statement from this connection's cache */
+  cache::lease prepare (std::string_view) noexcept(false);
+  cache& statements () noexcept;
+
+private:
+  friend deadline::scope;
+  friend statement;
+
+  /* The innermost deadline::scope. Kept apart, as the progress handler
+   * points at it for as long as the connection (and its moves) lives
+   */
+  std::unique_ptr<deadline::scope const*> current;
+  cache prepared;
 };
 
 void execute (connection&, std::string_view) noexcept(false);
@@ -1,8 +1,22 @@
 #ifndef APEX_SQLITE_CONTEXT_HPP
 #define APEX_SQLITE_CONTEXT_HPP
 
+#include <apex/memory/view.hpp>
+#include <apex/core/prelude.hpp>
+#include <apex/core/span.hpp>
+
+#include <system_error>
+#include <exception>
+#include <string_view>
+#include <memory>
+
+struct sqlite3_context;
+struct sqlite3_value;
+
 namespace apex::sqlite {
 
+using std::string_view;
+struct recording;
 struct value;
 
 struct context final {
@@ -16,6 +30,8 @@ struct context final {
   context () = delete;
 
   void operator = (std::error_code const&) const noexcept;
+  /* Reports the exception as the function's error, keeping sqlite error codes */
+  void operator = (std::exception_ptr const&) const noexcept;
 
   void operator = (string_view) const noexcept;
   void operator = (value const&) const noexcept;
@@ -29,6 +45,30 @@ struct context final {
   // TODO: Use tie apex::proxy::item here instead.
   value const& operator [] (ptrdiff_t) const noexcept;
 
+  /** Returns the object kept alongside a constant argument, making it first
+   * if there is none yet. sqlite keeps it for as long as the argument stays
+   * the same (usually for the whole statement), so a regex compiled from a
+   * constant pattern is only compiled once. sqlite may drop it at any time,
+   * which is why it is shared. The same T must be used for an argument.
+   *
+   * make() -> T
+   */
+  template <class T, class F>
+  std::shared_ptr<T> retain (ptrdiff_t idx, F&& make) const noexcept(false) {
+    if (auto ptr = this->auxiliary(idx)) { return *static_cast<std::shared_ptr<T>*>(ptr); }
+    auto item = std::make_shared<T>(static_cast<F&&>(make)());
+    auto destructor = [] (void* ptr) noexcept { delete static_cast<std::shared_ptr<T>*>(ptr); };
+    this->auxiliary(idx, new std::shared_ptr<T>(item), destructor);
+    return item;
+  }
+
+  void* auxiliary (ptrdiff_t) const noexcept;
+  /* sqlite owns the pointer from here on, even if this fails */
+  void auxiliary (ptrdiff_t, void*, void (*)(void*)) const noexcept;
+
+  /* Results set from here on are also copied into the recording */
+  void record (recording*) noexcept;
+
   pointer get () const noexcept;
   ptrdiff_t size () const noexcept;
   bool empty() const noexcept;
@@ -36,6 +76,9 @@ struct context final {
 
 private:
   resource_type handle;
+  sqlite3_value** values;
+  ptrdiff_t count;
+  recording* recorder { };
 };
 
 } /* namespace apex::sqlite */
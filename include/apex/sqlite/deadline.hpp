@@ -0,0 +1,85 @@
+#ifndef APEX_SQLITE_DEADLINE_HPP
+#define APEX_SQLITE_DEADLINE_HPP
+
+#include <stop_token>
+#include <chrono>
+
+namespace apex::sqlite {
+
+struct connection;
+struct statement;
+
+/** @brief A point in time and/or a stop token that bounds a statement.
+ *
+ * Every connection installs a progress handler when it is opened, which runs
+ * every `interval` VM instructions. Its user pointer is the connection's
+ * innermost deadline::scope, if any. With no scope, the handler does nothing
+ * more than check for a null pointer, so it is always left on. Otherwise it
+ * interrupts the running statement once any enclosing deadline has passed or
+ * had its stop token triggered, and the statement fails with
+ * error::interrupted.
+ *
+ * As the deadline belongs to the connection and not to the thread, it does
+ * not matter which thread (or executor) steps the statement. statement::execute
+ * takes one directly, and a scope bounds everything else stepped while it
+ * lives (iterating rows, decoding a query, fetching batches). Scopes nest, and
+ * an inner one can only ever cut an outer one short.
+ *
+ *   auto stmt = conn.prepare("DELETE FROM events WHERE expiry < unixepoch()");
+ *   stmt->execute(deadline { 50ms, request.stop_token() });
+ *
+ *   deadline::scope bound { conn, deadline { 50ms } };
+ *   for (auto [id, name] : query<std::tuple<i64, std::string>>(conn, sql)) { }
+ */
+struct deadline final {
+  using clock = std::chrono::steady_clock;
+
+  /* VM instructions between checks. Checking the clock costs ~20ns */
+  static constexpr int interval = 1000;
+
+  deadline (clock::time_point, std::stop_token) noexcept;
+  deadline (clock::duration, std::stop_token) noexcept;
+  explicit deadline (clock::time_point) noexcept;
+  explicit deadline (clock::duration) noexcept;
+  explicit deadline (std::stop_token) noexcept;
+  deadline () = delete;
+
+  /* Whether the time has passed or a stop has been requested */
+  bool expired () const noexcept;
+
+  struct scope;
+
+private:
+  friend connection;
+  friend statement;
+  static int progress (void*) noexcept;
+
+  clock::time_point until;
+  std::stop_token token;
+};
+
+/** @brief Applies a deadline to a connection for as long as it lives.
+ *
+ * Scopes must be destroyed in the reverse order they were created in, which
+ * is what keeping them on the stack does.
+ */
+struct deadline::scope final {
+  scope (connection&, deadline) noexcept;
+  scope (statement const&, deadline) noexcept;
+  scope (scope const&) = delete;
+  ~scope () noexcept;
+
+  scope& operator = (scope const&) = delete;
+
+private:
+  friend deadline;
+  scope (scope const**, deadline) noexcept;
+
+  deadline limit;
+  scope const* previous;
+  scope const** slot;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_DEADLINE_HPP */
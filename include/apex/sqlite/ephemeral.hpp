@@ -0,0 +1,80 @@
+#ifndef APEX_SQLITE_EPHEMERAL_HPP
+#define APEX_SQLITE_EPHEMERAL_HPP
+
+#include <apex/core/prelude.hpp>
+
+#include <string_view>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <map>
+
+struct sqlite3_vfs;
+
+namespace apex::sqlite {
+
+/** @brief A VFS whose files only ever live in this process's memory.
+ *
+ * Unlike `:memory:` databases, a file is shared by every connection that
+ * opens it by name, so several connections (on any number of threads) can
+ * read and write the same database at once. File locks and the WAL index are
+ * kept in memory as well, so WAL mode works as it would on disk, without a
+ * single syscall once a file is open.
+ *
+ * Each file reserves `capacity` bytes of address space when it is created,
+ * and is backed by anonymous memory (or a memfd, so it shows up in
+ * /proc/self/fd) as it grows. Writes past the capacity fail with
+ * SQLITE_FULL. Nothing is durable: files last until they are deleted (by
+ * sqlite or `remove`), or the VFS is destroyed. The VFS must outlive every
+ * connection opened with it.
+ *
+ *   ephemeral scratch { "scratch" };
+ *   connection conn { "jobs.db", access::read_write, scratch.name() };
+ *   execute(conn, "PRAGMA journal_mode=WAL");
+ */
+struct ephemeral final {
+  struct options;
+
+  ephemeral (std::string, options) noexcept(false);
+  explicit ephemeral (std::string) noexcept(false);
+  ephemeral (ephemeral const&) = delete;
+  ephemeral () = delete;
+  ~ephemeral () noexcept;
+
+  ephemeral& operator = (ephemeral const&) = delete;
+
+  char const* name () const noexcept;
+
+  /* Forgets the file, which is freed once no connection has it open */
+  bool remove (std::string_view) noexcept;
+  /* Bytes held by every file that has not been removed */
+  size_t size () const noexcept;
+
+  struct node;
+  struct file;
+
+private:
+  friend file;
+
+  std::unique_ptr<sqlite3_vfs> handle;
+  sqlite3_vfs* base;
+  std::string label;
+  size_t capacity;
+  bool memfd;
+
+  std::map<std::string, std::shared_ptr<node>, std::less<>> files;
+  mutable std::mutex mutex;
+};
+
+struct ephemeral::options final {
+  /* Address space reserved for each file */
+  size_t capacity { size_t { 1 } << 30 };
+  /* Back files with a memfd rather than anonymous memory */
+  bool memfd { false };
+  /* Use this VFS for connections that do not name one */
+  bool preferred { false };
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_EPHEMERAL_HPP */
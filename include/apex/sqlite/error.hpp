@@ -58,7 +58,7 @@ enum class error {
   filesystem_reserved_lock = 2594, //SQLITE_IOERR_CHECKRESERVEDLOCK
 };
 
-std::error_code make_error_code (error e) {
+inline std::error_code make_error_code (error e) {
   return std::error_code(static_cast<int>(e), category());
 }
 
@@ -0,0 +1,68 @@
+#ifndef APEX_SQLITE_EXECUTOR_HPP
+#define APEX_SQLITE_EXECUTOR_HPP
+
+#include <apex/core/coroutine.hpp>
+#include <apex/core/prelude.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <deque>
+#include <mutex>
+
+namespace apex::sqlite {
+
+/** @brief A dedicated thread for blocking sqlite calls.
+ *
+ * Coroutines move onto the executor with `co_await exec.schedule()`, and
+ * back off of it with `co_await exec.dispatch()`. The latter hands the
+ * coroutine to the dispatcher given at construction (e.g., one that posts it
+ * to an event loop), or resumes it on the executor's thread if there is none.
+ *
+ * Work runs in the order it was posted. As a connection can only be used by
+ * one thread at a time, a connection used from an executor should only ever
+ * be used from that executor. Destroying the executor finishes any work
+ * already posted.
+ */
+struct executor final {
+  using dispatch_type = std::function<void(coroutine_handle<>)>;
+  using work_type = std::function<void()>;
+
+  struct awaitable final {
+    bool await_ready () const noexcept { return false; }
+    void await_suspend (coroutine_handle<>) const noexcept(false);
+    void await_resume () const noexcept { }
+
+    executor& owner;
+    bool dispatching;
+  };
+
+  explicit executor (dispatch_type) noexcept(false);
+  executor () noexcept(false);
+  executor (executor const&) = delete;
+  ~executor () noexcept;
+
+  executor& operator = (executor const&) = delete;
+
+  awaitable schedule () noexcept { return { *this, false }; }
+  awaitable dispatch () noexcept { return { *this, true }; }
+
+  /* The work must not throw */
+  void post (work_type) noexcept(false);
+
+  bool running_in_this_thread () const noexcept;
+
+private:
+  void run () noexcept;
+
+  dispatch_type dispatcher;
+  std::deque<work_type> queue;
+  std::condition_variable ready;
+  std::mutex mutex;
+  bool stopping { false };
+  std::thread worker;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_EXECUTOR_HPP */
@@ -0,0 +1,86 @@
+#ifndef APEX_SQLITE_FLATFILE_HPP
+#define APEX_SQLITE_FLATFILE_HPP
+
+#include <apex/sqlite/column.hpp>
+#include <apex/sqlite/table.hpp>
+
+#include <filesystem>
+#include <variant>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace apex::sqlite {
+
+/** @brief A read-only virtual table over a memory-mapped text file.
+ *
+ * Each line of the file is a row, whose rowid is its line number (counting
+ * from 1, and not counting a header). Lines are split into columns either on
+ * a separator, or at fixed widths. Values point straight into the mapping,
+ * so a field is only ever copied when it is quoted and contains an escaped
+ * quote. Scans walk the file with a vectorized newline search, so nothing
+ * needs to be imported before it can be queried.
+ *
+ * Constraints on the rowid seek instead of scanning. The offsets of every
+ * 64th line are recorded the first time a seek needs them, and are shared
+ * by every connection, so later seeks are cheap.
+ *
+ * Columns are given as they would be in CREATE TABLE ("status INTEGER").
+ * Fields of INTEGER, REAL, and NUMERIC columns that parse as numbers are
+ * returned as numbers, and everything else is returned as TEXT. With no
+ * columns given, they are named after the header (if there is one), or
+ * c1, c2, and so on after the fields of the first line. A missing field is
+ * NULL.
+ *
+ * The file must not be truncated while it is mapped.
+ */
+struct flatfile final : table {
+  struct delimited final {
+    char separator { ',' };
+    char quote { '"' };
+    /* The first line names the columns, and is not a row */
+    bool header { false };
+  };
+
+  /* Width of each column in bytes. Fields have their padding trimmed */
+  struct fixed final {
+    std::vector<size_t> widths;
+  };
+
+  using format_type = std::variant<delimited, fixed>;
+
+  struct mapping;
+
+  flatfile (std::filesystem::path const&, format_type, std::vector<std::string>) noexcept(false);
+  flatfile (std::filesystem::path const&, format_type) noexcept(false);
+
+  /* Counts every line, if no seek has reached the end yet */
+  size_t lines () noexcept(false);
+
+  std::shared_ptr<table> clone () const noexcept(false) override;
+
+  void connect (std::any) noexcept(false) override;
+  void create (std::any) noexcept(false) override;
+
+  void disconnect () noexcept(false) override;
+  void destroy () noexcept(false) override;
+
+  std::shared_ptr<cursor> iterator () const noexcept(false) override;
+
+  index::output const& access (index::input const&) noexcept(false) override;
+
+  string schema () noexcept(false) override;
+  void rename (char const*) noexcept(false) override;
+
+private:
+  struct scanner;
+
+  explicit flatfile (std::shared_ptr<mapping>) noexcept;
+
+  std::shared_ptr<mapping> data;
+  index::output plan;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_FLATFILE_HPP */
@@ -0,0 +1,46 @@
+#ifndef APEX_SQLITE_HISTOGRAM_HPP
+#define APEX_SQLITE_HISTOGRAM_HPP
+
+#include <apex/core/prelude.hpp>
+
+#include <chrono>
+#include <atomic>
+#include <array>
+
+namespace apex::sqlite {
+
+/** @brief A lock free, log2 bucketed latency histogram.
+ *
+ * Bucket N holds durations in the range [2^(N-1), 2^N) nanoseconds, with
+ * bucket 0 holding zero length durations. Recording is a pair of relaxed
+ * atomic increments, so this is safe to share between threads and cheap
+ * enough to leave enabled.
+ */
+struct histogram final {
+  using duration = std::chrono::nanoseconds;
+  static constexpr size_t buckets = 64;
+
+  histogram (histogram const&) = delete;
+  histogram () noexcept = default;
+
+  histogram& operator = (histogram const&) = delete;
+
+  /* returns the number of samples in the given bucket */
+  u64 operator [] (size_t) const noexcept;
+
+  void record (duration) noexcept;
+  void clear () noexcept;
+
+  /* upper bound of the bucket the given percentile (0.0 - 1.0) falls into */
+  duration percentile (f64) const noexcept;
+  duration total () const noexcept;
+  u64 count () const noexcept;
+
+private:
+  std::array<std::atomic<u64>, buckets> counts { };
+  std::atomic<u64> sum { };
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_HISTOGRAM_HPP */
@@ -0,0 +1,91 @@
+#ifndef APEX_SQLITE_INSERT_HPP
+#define APEX_SQLITE_INSERT_HPP
+
+#include <apex/detail/sqlite/fields.hpp>
+
+#include <apex/sqlite/transaction.hpp>
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/statement.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+namespace apex::detail::sqlite {
+
+using ::apex::sqlite::connection;
+using ::apex::sqlite::statement;
+
+std::string insertion (std::string_view, size_t, size_t) noexcept(false);
+size_t variables (connection const&) noexcept;
+
+template <class T>
+void bind_fields (statement const& stmt, ptrdiff_t offset, T const& row) noexcept(false) {
+  std::apply([&] (auto const&... fields) {
+    auto idx = offset;
+    (::apex::sqlite::bind(stmt, ++idx, fields), ...);
+  }, ::apex::detail::sqlite::tie(row));
+}
+
+template <class Range>
+void insert (connection& conn, std::string_view table, Range const& rows, size_t chunk) noexcept(false) {
+  using iterator = decltype(std::begin(rows));
+  using row_type = remove_cvref_t<decltype(*std::begin(rows))>;
+  constexpr auto columns = field_count_v<row_type>;
+
+  // Rows that do not fill an entire chunk are bound a second time against a
+  // shorter statement, which requires a multi-pass range.
+  if constexpr (not std::forward_iterator<iterator>) { chunk = 1; }
+  chunk = std::max(size_t { 1 }, std::min(chunk, variables(conn) / columns));
+
+  auto stmt = conn.prepare(insertion(table, columns, chunk));
+  auto first = std::begin(rows);
+  auto mark = first;
+  size_t count = 0;
+  for (auto last = std::end(rows); first != last; ++first) {
+    bind_fields(*stmt, static_cast<ptrdiff_t>(count * columns), *first);
+    if (++count < chunk) { continue; }
+    stmt->execute();
+    count = 0;
+    if constexpr (std::forward_iterator<iterator>) { mark = std::next(first); }
+  }
+  if (not count) { return; }
+
+  auto const sql = insertion(table, columns, count);
+  auto text = std::string_view { sql };
+  statement remainder { conn, text };
+  for (size_t idx = 0; idx < count; ++idx, ++mark) {
+    bind_fields(remainder, static_cast<ptrdiff_t>(idx * columns), *mark);
+  }
+  remainder.execute();
+}
+
+} /* namespace apex::detail::sqlite */
+
+namespace apex::sqlite {
+
+/** @brief Inserts every row of a range inside of a single immediate
+ * transaction.
+ *
+ * Each row must be either tuple-like or an aggregate, whose fields are bound
+ * in declaration order. When chunk is larger than 1, up to chunk rows are
+ * inserted per statement via a multi-row `VALUES (...), (...)` clause. The
+ * chunk is clamped so the statement never exceeds the connection's limit on
+ * the number of bound parameters.
+ *
+ * The table is placed into the generated SQL verbatim, so it may contain a
+ * schema name or column list (e.g., `"main.items (name, size)"`). It must
+ * *never* come from untrusted input.
+ *
+ * @note As this begins a transaction, it cannot be called from inside of one.
+ */
+template <class Range>
+void bulk_insert (connection& conn, std::string_view table, Range const& rows, size_t chunk = 1) noexcept(false) {
+  transaction tx { conn, behavior::immediate };
+  ::apex::detail::sqlite::insert(conn, table, rows, chunk);
+  tx.commit();
+}
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_INSERT_HPP */
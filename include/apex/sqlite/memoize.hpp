@@ -0,0 +1,52 @@
+#ifndef APEX_SQLITE_MEMOIZE_HPP
+#define APEX_SQLITE_MEMOIZE_HPP
+
+#include <apex/sqlite/connection.hpp>
+#include <apex/core/prelude.hpp>
+
+#include <string_view>
+#include <variant>
+#include <string>
+#include <vector>
+
+namespace apex::sqlite {
+
+/** @brief A copy of the result a function set through its context.
+ *
+ * A function that sets no result returns NULL, which is the monostate.
+ */
+struct recording final {
+  using result_type = std::variant<std::monostate, i64, f64, std::string, std::vector<byte>>;
+
+  result_type result;
+  /* Errors are never cached */
+  bool failed { false };
+};
+
+/** @brief Opts a function into caching its results by its arguments.
+ *
+ * A memoized function is pure, and is only called once for each distinct set
+ * of arguments (for as long as they stay in the cache). Integers, reals,
+ * NULLs, and TEXT or BLOBs are all hashed inline. Calls whose arguments take
+ * up more than `limit` bytes bypass the cache.
+ *
+ * The cache is split into sets of two entries, and a new set of arguments
+ * evicts the least recently used entry of its set. It belongs to the
+ * connection the function is registered on, and lasts across statements.
+ * Functions must set their results through the context's assignment
+ * operators, which is how the result is copied.
+ *
+ *   function(conn, "normalize_url", 1, memoize { .entries = 4096 }, normalize);
+ */
+struct memoize final {
+  static constexpr size_t limit = 64;
+
+  /* Rounded up to a power of two, and at least two */
+  size_t entries { 1024 };
+};
+
+void function (connection&, std::string_view, ptrdiff_t, memoize, function_t) noexcept(false);
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_MEMOIZE_HPP */
@@ -9,11 +9,30 @@ namespace apex::sqlite {
 
 template <class> struct default_delete;
 
+/** The allocator sqlite uses for *all* of its memory.
+ *
+ * `pooled` is a size-class allocator with a per-thread cache of free blocks
+ * for each class, backed by a shared depot. Blocks are carved out of large
+ * slabs that are never returned to the system. Allocations larger than the
+ * largest class go straight to malloc. Installing it also turns off sqlite's
+ * own memory statistics, as those take a global mutex on every call.
+ */
+enum class allocator { system, pooled };
+
+/* Must be called before any connection is opened */
+void install (allocator) noexcept(false);
+
+// These always go through whichever allocator sqlite is currently using
 void* reallocate (void*, size_t);
 void* allocate (size_t);
 void deallocate (void*);
 
+/* Bytes currently allocated by sqlite */
 size_t allocated () noexcept;
+/* Bytes currently allocated from the size class serving the given size.
+ * Always 0 unless the pooled allocator is installed.
+ */
+size_t allocated (size_t) noexcept;
 
 template <class T>
 using view_handle = mixin::resource<
@@ -0,0 +1,42 @@
+#ifndef APEX_SQLITE_PAGE_HPP
+#define APEX_SQLITE_PAGE_HPP
+
+#include <apex/core/prelude.hpp>
+
+namespace apex::sqlite {
+
+/** The page cache sqlite uses for every database.
+ *
+ * `slab` stores pages in 2MiB slabs, which are mapped with MAP_HUGETLB when
+ * huge pages are reserved, and are otherwise advised as transparent huge
+ * page candidates. Slabs are shared by every cache with the same page layout,
+ * and are never unmapped. Once a cache is at capacity, pages are evicted with
+ * a clock-sweep (second chance) policy instead of LRU, so a hit only ever
+ * sets a flag.
+ *
+ * Slabs are first touched by the thread that needs a page, so under the
+ * default Linux policy they are local to the NUMA node of that thread.
+ */
+enum class page_cache { system, slab };
+
+/* Must be called before any connection is opened */
+void install (page_cache) noexcept(false);
+
+struct page_statistics final {
+  u64 hits;
+  u64 misses;
+  u64 evictions;
+  u64 slabs;
+
+  f64 hit_rate () const noexcept {
+    auto const total = this->hits + this->misses;
+    return total ? static_cast<f64>(this->hits) / static_cast<f64>(total) : 0.0;
+  }
+};
+
+/* Always zeroed unless the slab page cache is installed */
+page_statistics pages () noexcept;
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_PAGE_HPP */
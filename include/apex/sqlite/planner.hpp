@@ -0,0 +1,93 @@
+#ifndef APEX_SQLITE_PLANNER_HPP
+#define APEX_SQLITE_PLANNER_HPP
+
+#include <apex/sqlite/table.hpp>
+
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace apex::sqlite {
+
+/** @brief Picks a plan for table::access from what the table can do.
+ *
+ * A table declares, per column (-1 being the rowid), which restraints its
+ * cursor can narrow a scan with, and roughly how many distinct values the
+ * column holds. A column that can be sought walks only the rows that match
+ * its constraints, in the column's order, and may lead the scan. Everything
+ * else is a plain walk in rowid order, with supported constraints applied to
+ * each row as it is visited.
+ *
+ * Every usable, supported constraint is handed to the cursor. Costs are in
+ * rows visited (plus a binary search for a seek, and a sort when the ORDER
+ * BY is not met), and the cheapest lead is chosen. An equality keeps one in
+ * `distinct` rows, and each side of a range keeps a third.
+ *
+ * The plan is described in the index number and label, which the cursor
+ * reads back with planner::choice.
+ *
+ *   index::output const& events::access (index::input const& input) {
+ *     planner { this->size() }
+ *       .support(-1, { .restraints = planner::ranges, .distinct = this->size(), .seek = true })
+ *       .support(2, { .restraints = { restraint::equal_to }, .distinct = 50 })
+ *       .plan(input, this->output);
+ *     return this->output;
+ *   }
+ */
+struct planner final {
+  struct capability final {
+    std::vector<restraint> restraints;
+    /* Estimated number of distinct values. 0 assumes an equality keeps a tenth */
+    f64 distinct { };
+    /* The cursor can jump to the matching rows, and return them in order */
+    bool seek { false };
+    /* A seek can also walk the column backwards */
+    bool reverse { false };
+    /* Only usable when compared with the BINARY collation */
+    bool binary { false };
+    /* The cursor checks the constraint exactly, so sqlite need not */
+    omit skip { omit::no };
+  };
+
+  struct term final {
+    i32 column;
+    restraint op;
+  };
+
+  /** @brief A plan, as read back by cursor::filter.
+   *
+   * `terms` has one entry per filter value, in the same order.
+   */
+  struct choice final {
+    explicit choice (filter const&) noexcept(false);
+
+    std::vector<term> terms;
+    /* The column leading the scan, or -1 for a walk in rowid order */
+    i32 lead { -1 };
+    direction order { direction::ascend };
+  };
+
+  static inline std::initializer_list<restraint> const ranges {
+    restraint::equal_to,
+    restraint::greater,
+    restraint::greater_equal,
+    restraint::less,
+    restraint::less_equal,
+  };
+
+  explicit planner (f64) noexcept;
+
+  planner& support (i32, capability) noexcept(false);
+  /* Fills in the output, replacing whatever it held */
+  void plan (index::input const&, index::output&) const noexcept(false);
+
+private:
+  ptrdiff_t locate (i32) const noexcept;
+
+  std::vector<std::pair<i32, capability>> columns;
+  f64 rows;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_PLANNER_HPP */
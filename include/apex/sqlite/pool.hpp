@@ -0,0 +1,93 @@
+#ifndef APEX_SQLITE_POOL_HPP
+#define APEX_SQLITE_POOL_HPP
+
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/histogram.hpp>
+#include <apex/mixin/resource.hpp>
+
+#include <condition_variable>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace apex::sqlite {
+
+/** @brief A fixed set of read-only connections, plus a single writer.
+ *
+ * The database is placed into WAL mode when the pool is created, so readers
+ * never block the writer (or each other). Each reader connection is only ever
+ * handed to one thread at a time, and connections are opened without
+ * sqlite's internal mutex, so reads scale with the number of readers.
+ *
+ * Connections are handed out as leases, which return the connection to the
+ * pool when destroyed. The pool must outlive every lease it hands out.
+ */
+struct pool final {
+  using duration = std::chrono::nanoseconds;
+  struct lease;
+
+  /* Opens the given number of readers, which must not be zero */
+  pool (std::filesystem::path const&, size_t) noexcept(false);
+  pool (pool const&) = delete;
+  pool () = delete;
+
+  pool& operator = (pool const&) = delete;
+
+  /* Blocks until a connection is available */
+  lease reader () noexcept(false);
+  lease writer () noexcept(false);
+
+  /* Waits at most the given duration, and throws error::resource_busy if
+   * nothing became available. A zero duration fails fast.
+   */
+  lease reader (duration) noexcept(false);
+  lease writer (duration) noexcept(false);
+
+  histogram const& reader_waits () const noexcept;
+  histogram const& writer_waits () const noexcept;
+
+  size_t readers () const noexcept;
+
+private:
+  struct recycle final {
+    void operator () (connection*) const noexcept;
+    pool* owner;
+  };
+
+  lease read (duration const*) noexcept(false);
+  lease write (duration const*) noexcept(false);
+  void release (connection*) noexcept;
+
+  connection primary;
+  std::vector<connection> connections;
+  std::vector<connection*> idle;
+  bool writing { false };
+
+  std::condition_variable readable;
+  std::condition_variable writable;
+  std::mutex mutex;
+
+  histogram read_waits;
+  histogram write_waits;
+};
+
+struct pool::lease final : private mixin::resource<connection, std::unique_ptr<connection, pool::recycle>> {
+  using resource_type::operator bool;
+  using resource_type::get;
+
+  lease (lease&&) noexcept = default;
+  lease& operator = (lease&&) noexcept = default;
+
+  connection& operator * () const noexcept { return *this->get(); }
+  connection* operator -> () const noexcept { return this->get(); }
+
+private:
+  friend pool;
+  lease (connection*, pool::recycle) noexcept;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_POOL_HPP */
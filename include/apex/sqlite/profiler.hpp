@@ -0,0 +1,116 @@
+#ifndef APEX_SQLITE_PROFILER_HPP
+#define APEX_SQLITE_PROFILER_HPP
+
+#include <apex/core/functional.hpp>
+#include <apex/core/source.hpp>
+
+#include <apex/sqlite/histogram.hpp>
+
+#include <unordered_map>
+#include <chrono>
+#include <string_view>
+#include <functional>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+struct sqlite3_stmt;
+
+namespace apex::sqlite {
+
+struct connection;
+
+/** @brief Per statement timing for a single connection.
+ *
+ * Statements are grouped by their normalized SQL (literals replaced with ?)
+ * when sqlite is built with SQLITE_ENABLE_NORMALIZE, and by their original
+ * text otherwise. Each run records its wall time, the rows it returned, and
+ * the VM instructions it executed. Recording is a hash lookup plus a handful
+ * of relaxed atomic additions, and only the first run of a new statement takes
+ * a lock.
+ *
+ * Runs slower than the threshold are handed to the reporter, along with the
+ * innermost profiler::site on the current thread (if any), which marks the
+ * call site responsible for them. The reporter runs on the connection's
+ * thread, in the middle of sqlite3_step, and must not use the connection.
+ */
+struct profiler final {
+  using duration = std::chrono::nanoseconds;
+  struct statistics;
+  struct report;
+  struct site;
+
+  using reporter_type = std::function<void(report const&)>;
+
+  profiler (connection&, duration, reporter_type) noexcept(false);
+  profiler (connection&) noexcept(false);
+  profiler (profiler const&) = delete;
+  profiler () = delete;
+  ~profiler () noexcept;
+
+  profiler& operator = (profiler const&) = delete;
+
+  /* Safe to call from any thread */
+  void visit (function_ref<void(std::string_view, statistics const&)>) const noexcept(false);
+  void clear () noexcept;
+
+private:
+  /* sqlite's own profile times only have millisecond resolution */
+  struct running final {
+    std::chrono::steady_clock::time_point start;
+    sqlite3_stmt* stmt;
+    u64 rows;
+  };
+
+  static int trace (unsigned, void*, void*, void*) noexcept;
+  void record (ptrdiff_t) noexcept;
+
+  statistics& lookup (sqlite3_stmt*) noexcept(false);
+
+  connection& traced;
+  reporter_type reporter;
+  duration threshold;
+
+  std::unordered_map<std::string_view, std::unique_ptr<statistics>> entries;
+  /* rows returned by each statement that is currently running */
+  std::vector<running> active;
+  mutable std::mutex mutex;
+};
+
+struct profiler::statistics final {
+  histogram elapsed;
+  std::atomic<u64> calls { };
+  std::atomic<u64> rows { };
+  std::atomic<u64> steps { };
+  std::string sql;
+};
+
+struct profiler::report final {
+  std::string_view sql;
+  duration elapsed;
+  u64 rows;
+  u64 steps;
+  source_location location;
+};
+
+/* Marks the current thread's call site until destroyed */
+struct profiler::site final {
+  explicit site (source_location = source_location::current()) noexcept;
+  site (site const&) = delete;
+  ~site () noexcept;
+
+  site& operator = (site const&) = delete;
+
+  source_location location;
+
+private:
+  friend profiler;
+  static site const* current () noexcept;
+  site const* previous;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_PROFILER_HPP */
@@ -0,0 +1,106 @@
+#ifndef APEX_SQLITE_QUERY_HPP
+#define APEX_SQLITE_QUERY_HPP
+
+#include <apex/detail/sqlite/fields.hpp>
+
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/column.hpp>
+#include <apex/sqlite/row.hpp>
+
+#include <string_view>
+#include <string>
+#include <array>
+
+namespace apex::detail::sqlite {
+
+using ::apex::sqlite::statement;
+using ::apex::sqlite::affinity;
+
+template <class T>
+constexpr affinity affinity_of () noexcept {
+  if constexpr (integral<T>) { return affinity::integer; }
+  else if constexpr (floating_point<T>) { return affinity::real; }
+  else if constexpr (same_as<T, std::string> or same_as<T, std::string_view>) { return affinity::text; }
+  else { return affinity::blob; }
+}
+
+// Throws error::argument_type_mismatch if the statement has a different
+// number of columns, or any column's declared type cannot hold its field.
+void expect (statement const&, span<affinity const>) noexcept(false);
+
+template <class> struct affinities;
+template <class... Ts>
+struct affinities<std::tuple<Ts...>> {
+  static constexpr std::array<affinity, sizeof...(Ts)> value {
+    affinity_of<remove_cvref_t<Ts>>()...
+  };
+};
+
+template <class T>
+void check (statement const& stmt) noexcept(false) {
+  using tuple_type = decltype(::apex::detail::sqlite::tie(std::declval<T&>()));
+  auto const& expected = affinities<tuple_type>::value;
+  expect(stmt, span<affinity const> { expected.data(), expected.size() });
+}
+
+} /* namespace apex::detail::sqlite */
+
+namespace apex::sqlite {
+
+/** @brief A single pass range of rows, each decoded into a T.
+ *
+ * Holds on to the cached statement it was created from, which is reset and
+ * returned to the cache once the results are destroyed.
+ */
+template <class T>
+struct results final {
+  struct sentinel final { };
+
+  struct iterator final {
+    using difference_type = ptrdiff_t;
+    using value_type = T;
+
+    T operator * () const noexcept(false) { return this->current.template as<T>(); }
+
+    iterator& operator ++ () noexcept(false) {
+      ++this->current;
+      return *this;
+    }
+    void operator ++ (int) noexcept(false) { ++*this; }
+
+    bool operator == (sentinel) const noexcept { return this->current == row { }; }
+    bool operator != (sentinel) const noexcept { return this->current != row { }; }
+
+    row current;
+  };
+
+  explicit results (cache::lease&& stmt) noexcept :
+    stmt { static_cast<cache::lease&&>(stmt) }
+  { }
+
+  iterator begin () noexcept(false) { return iterator { row { *this->stmt } }; }
+  sentinel end () const noexcept { return { }; }
+
+private:
+  cache::lease stmt;
+};
+
+/** @brief Runs a query, decoding each row into an aggregate or tuple-like T.
+ *
+ * The mapping of columns to fields is positional, and fixed at compile time.
+ * The column count and declared types are checked once here, so iterating
+ * the results only ever calls the sqlite3_column_* function for each field.
+ */
+template <class T, class... Args> requires ::apex::detail::sqlite::fields<T>
+results<T> query (connection& conn, std::string_view sql, Args const&... args) noexcept(false) {
+  auto stmt = conn.prepare(sql);
+  ::apex::detail::sqlite::check<T>(*stmt);
+  ptrdiff_t idx = 0;
+  (bind(*stmt, ++idx, args), ...);
+  return results<T> { static_cast<cache::lease&&>(stmt) };
+}
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_QUERY_HPP */
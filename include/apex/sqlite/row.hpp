@@ -1,24 +1,38 @@
 #ifndef APEX_SQLITE_ROW_HPP
 #define APEX_SQLITE_ROW_HPP
 
+#include <apex/detail/sqlite/fields.hpp>
+
 #include <apex/core/concepts.hpp>
+#include <apex/core/span.hpp>
 #include <apex/memory/view.hpp>
 
 #include <apex/sqlite/column.hpp>
 
+#include <string_view>
+#include <string>
+#include <tuple>
+
 struct sqlite3_stmt;
 
 namespace apex::sqlite {
 
 struct statement;
 
+/** @brief The current result row of a statement.
+ *
+ * A row is also an input iterator over its statement. Constructing one from a
+ * statement steps it once, and incrementing steps it again. Once the statement
+ * has no more results, the row compares equal to a default constructed one.
+ */
 struct row final /*: private mixin::iterator<row>*/ {
   using resource_type = view_ptr<sqlite3_stmt>;
   using pointer = resource_type::pointer;
+  using difference_type = ptrdiff_t;
+  using value_type = row;
 
-  explicit row (statement const&) noexcept;
-
-  //row () = delete;
+  explicit row (statement const&) noexcept(false);
+  row () noexcept = default;
 
   void swap (row&) noexcept;
 
@@ -27,13 +41,52 @@ struct row final /*: private mixin::iterator<row>*/ {
 
   ptrdiff_t distance_to (row const&) const noexcept;
   column read_from () const noexcept;
-  void advance (ptrdiff_t) noexcept;
+  void advance (ptrdiff_t) noexcept(false);
+
+  row const& operator * () const noexcept { return *this; }
+  row& operator ++ () noexcept(false) {
+    this->advance(1);
+    return *this;
+  }
+
+  bool operator == (row const&) const noexcept;
+  bool operator != (row const&) const noexcept;
+
+  pointer get () const noexcept;
+  ptrdiff_t size () const noexcept;
+
+  /** Decodes the row into an aggregate or tuple-like type, where column N is
+   * assigned to field N. No checks are done here, as this is meant for hot
+   * loops. Use sqlite::query to have columns checked once per statement.
+   * Any std::string_view or span fields are only valid until the next step.
+   */
+  template <class T> requires ::apex::detail::sqlite::fields<T>
+  T as () const noexcept(false) {
+    T result { };
+    std::apply([this] (auto&... fields) {
+      ptrdiff_t idx = 0;
+      (fetch(*this, idx++, fields), ...);
+    }, ::apex::detail::sqlite::tie(result));
+    return result;
+  }
 
 private:
   resource_type handle;
-  i64 count;
+  i64 count { };
 };
 
+void fetch (row const&, ptrdiff_t, span<byte const>&) noexcept;
+void fetch (row const&, ptrdiff_t, std::string_view&) noexcept;
+void fetch (row const&, ptrdiff_t, std::string&) noexcept(false);
+
+void fetch (row const&, ptrdiff_t, f64&) noexcept;
+void fetch (row const&, ptrdiff_t, f32&) noexcept;
+void fetch (row const&, ptrdiff_t, u64&) noexcept;
+void fetch (row const&, ptrdiff_t, u32&) noexcept;
+void fetch (row const&, ptrdiff_t, i64&) noexcept;
+void fetch (row const&, ptrdiff_t, i32&) noexcept;
+void fetch (row const&, ptrdiff_t, bool&) noexcept;
+
 } /* namespace apex::sqlite */
 
 #endif /* APEX_SQLITE_ROW_HPP */
@@ -0,0 +1,111 @@
+#ifndef APEX_SQLITE_SCAN_HPP
+#define APEX_SQLITE_SCAN_HPP
+
+#include <apex/core/functional.hpp>
+
+#include <apex/sqlite/query.hpp>
+#include <apex/sqlite/pool.hpp>
+
+#include <string_view>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace apex::detail::sqlite {
+
+using ::apex::sqlite::connection;
+using ::apex::sqlite::cache;
+using ::apex::sqlite::pool;
+
+/* Inclusive */
+struct range final {
+  i64 first;
+  i64 last;
+};
+
+// Splits the rowids of the table into (at most) the given number of ranges
+// of equal width.
+std::vector<range> partition (connection&, std::string_view, size_t) noexcept(false);
+
+// Prepares the statement, which must be read-only, and binds the range to
+// its :first and :last parameters.
+cache::lease prepare (connection&, std::string_view, range) noexcept(false);
+
+// Calls reserve once with the number of ranges, and then each for every
+// range, from up to pool::readers() threads at once. Every thread reads
+// from the same snapshot. The first exception thrown stops the scan, and is
+// rethrown once every thread has stopped.
+void scan (
+  pool&,
+  std::string_view,
+  size_t,
+  function_ref<void(size_t)> reserve,
+  function_ref<void(connection&, range, size_t)> each) noexcept(false);
+
+} /* namespace apex::detail::sqlite */
+
+namespace apex::sqlite {
+
+/** @brief Runs a read-only query over a rowid table on several readers.
+ *
+ * The query must restrict itself to the rowids between its :first and :last
+ * parameters (e.g. `WHERE rowid BETWEEN :first AND :last`). The table's
+ * rowids are split into `parts` ranges of equal width, which are handed out
+ * to the pool's readers as they finish their previous one, so having more
+ * parts than readers evens out skewed ranges. All readers see the same
+ * snapshot of the database.
+ *
+ * Rows are returned in rowid range order, so a query ordered by rowid keeps
+ * its order.
+ */
+template <class T> requires ::apex::detail::sqlite::fields<T>
+std::vector<T> scan (pool& readers, std::string_view table, std::string_view sql, size_t parts) noexcept(false) {
+  std::vector<std::vector<T>> partials;
+  ::apex::detail::sqlite::scan(readers, table, parts,
+    [&partials] (size_t count) { partials.resize(count); },
+    [&partials, sql] (connection& conn, auto span, size_t idx) {
+      auto stmt = ::apex::detail::sqlite::prepare(conn, sql, span);
+      ::apex::detail::sqlite::check<T>(*stmt);
+      for (auto&& item : results<T> { std::move(stmt) }) { partials[idx].push_back(std::move(item)); }
+    });
+  size_t total = 0;
+  for (auto const& partial : partials) { total += partial.size(); }
+  std::vector<T> rows;
+  rows.reserve(total);
+  for (auto& partial : partials) {
+    std::move(partial.begin(), partial.end(), std::back_inserter(rows));
+  }
+  return rows;
+}
+
+/** As above, but rows are folded into one accumulator per range on the
+ * reader's thread, each starting from a copy of init (which should be the
+ * identity of combine). The accumulators are then combined in range order on
+ * the calling thread. Both functions are called from several threads at once.
+ *
+ * fold(R&&, T&&) -> R
+ * combine(R&&, R&&) -> R
+ */
+template <class T, class R, class Fold, class Combine> requires ::apex::detail::sqlite::fields<T>
+R scan (pool& readers, std::string_view table, std::string_view sql, size_t parts, R init, Fold fold, Combine combine) noexcept(false) {
+  std::vector<R> partials;
+  ::apex::detail::sqlite::scan(readers, table, parts,
+    [&partials, &init] (size_t count) { partials.resize(count, init); },
+    [&partials, &fold, sql] (connection& conn, auto span, size_t idx) {
+      auto stmt = ::apex::detail::sqlite::prepare(conn, sql, span);
+      ::apex::detail::sqlite::check<T>(*stmt);
+      auto& result = partials[idx];
+      for (auto&& item : results<T> { std::move(stmt) }) { result = fold(std::move(result), std::move(item)); }
+    });
+  if (partials.empty()) { return init; }
+  auto result = std::move(partials.front());
+  for (size_t idx = 1; idx < partials.size(); ++idx) {
+    result = combine(std::move(result), std::move(partials[idx]));
+  }
+  return result;
+}
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_SCAN_HPP */
@@ -0,0 +1,49 @@
+#ifndef APEX_SQLITE_SNAPSHOT_HPP
+#define APEX_SQLITE_SNAPSHOT_HPP
+
+#include <apex/sqlite/memory.hpp>
+#include <apex/core/string.hpp>
+
+#include <string>
+#include <memory>
+
+struct sqlite3_snapshot;
+
+namespace apex::sqlite {
+
+struct connection;
+
+/** @brief A point in a WAL database's history, which other connections can
+ * start their read transactions at.
+ *
+ * A snapshot is captured from a connection inside a read transaction, and
+ * stays readable for as long as that transaction is open, as no checkpoint
+ * can then overwrite the pages it needs. Snapshots are cheap to copy, so one
+ * can be handed to any number of reader threads, each of which opens a
+ * transaction (see transaction's snapshot constructor) to read the exact
+ * same data.
+ *
+ * Requires sqlite to be built with SQLITE_ENABLE_SNAPSHOT.
+ */
+struct snapshot final : private shared_handle<sqlite3_snapshot> {
+  using resource_type::get;
+
+  /* Throws error::inappropriate_operation if the connection is not inside a transaction */
+  explicit snapshot (connection&, zstring_view) noexcept(false);
+  explicit snapshot (connection&) noexcept(false);
+  snapshot () = delete;
+
+  std::string const& schema () const noexcept;
+
+  /* Older snapshots compare less than newer ones */
+  bool operator == (snapshot const&) const noexcept;
+  bool operator != (snapshot const&) const noexcept;
+  bool operator < (snapshot const&) const noexcept;
+
+private:
+  std::string name;
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_SNAPSHOT_HPP */
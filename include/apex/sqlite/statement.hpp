@@ -6,41 +6,62 @@
 #include <apex/core/scope.hpp>
 #include <apex/core/span.hpp>
 
+#include <apex/sqlite/deadline.hpp>
+#include <apex/sqlite/memory.hpp>
 #include <apex/sqlite/row.hpp>
 
+#include <string_view>
 #include <memory>
 
 struct sqlite3_stmt;
 
 namespace apex::sqlite {
 
+template <>
+struct default_delete<sqlite3_stmt> {
+  void operator () (sqlite3_stmt*) noexcept;
+};
+
 struct connection;
 struct value;
 
-// TODO: use apex::mixin::handle. This will reduce implementation work needed
-// TODO: add a sqlite_deleter for these APIs
-struct statement {
-  using resource_type = std::unique_ptr<
-    sqlite3_stmt,
-    std::add_lvalue_reference_t<int(sqlite3_stmt*)>
-  >;
+struct statement : protected unique_handle<sqlite3_stmt> {
   using pointer = resource_type::pointer;
   using iterator = row;
 
-  statement ();
+  using resource_type::operator bool;
+  using resource_type::get;
+
+  /** Prepares the first statement found in the given text, and then advances
+   * the text past it. Any leading whitespace in the remaining text is removed,
+   * so an empty view means there is nothing left to prepare.
+   */
+  statement (connection&, std::string_view&) noexcept(false);
+  statement () noexcept = default;
 
-  iterator begin () const noexcept;
+  /* steps the statement, see row for details */
+  iterator begin () const noexcept(false);
   iterator end () const noexcept;
 
+  std::string_view sql () const noexcept;
+
   bool is_readonly () const noexcept;
   bool is_busy () const noexcept;
 
-  pointer get () const noexcept;
+  /* steps the statement to completion, and then resets it */
+  void execute () noexcept(false);
+  /* as above, but stops with error::interrupted at the deadline (or that of
+   * any deadline::scope it runs in) */
+  void execute (deadline const&) noexcept(false);
+  void execute (deadline::clock::time_point) noexcept(false);
+  void execute (std::stop_token) noexcept(false);
+  void reset () noexcept;
+  void clear () noexcept;
 
 private:
+  friend deadline::scope;
+
   ptrdiff_t index (char const*) noexcept(false);
-  void execute () noexcept(false);
-  void clear () noexcept;
 
   template <class... Args, size_t... Is>
   void command (std::index_sequence<Is...>, Args const&... args) noexcept(false) {
@@ -56,7 +77,8 @@ private:
     return iterable<iterator> { std::begin(*this), std::end(*this) };
   }
 
-  resource_type handle;
+  /* Where its connection keeps the innermost deadline::scope */
+  deadline::scope const** bounds { };
 };
 
 void bind (statement const&, ptrdiff_t, span<byte const>) noexcept(false);
@@ -4,10 +4,15 @@
 #include <apex/memory/view.hpp>
 #include <apex/core/prelude.hpp>
 
+#include <string_view>
+#include <memory>
 #include <string>
 #include <vector>
+#include <deque>
 #include <any>
 
+struct sqlite3_index_info;
+struct sqlite3;
 struct sqlite3_module;
 
 namespace apex::sqlite {
@@ -38,8 +43,6 @@ enum class direction : bool { ascend, descend };
 enum class omit : bool { no, yes };
 
 struct index { struct output; struct input; };
-struct filter;
-struct usage;
 
 struct constraint final {
   constraint (u8, bool, i32) noexcept;
@@ -66,6 +69,63 @@ private:
   i32 idx;
 };
 
+/* How a constraint is handed to cursor::filter. An argument of 0 means the
+ * constraint is not passed at all. Otherwise, it is the (1-based) position
+ * of its right-hand side among the filter's values.
+ */
+struct usage final {
+  i32 argument { };
+  omit skip { omit::no };
+};
+
+struct index::input final {
+  explicit input (sqlite3_index_info*) noexcept(false);
+
+  std::vector<constraint> const& constraints () const noexcept;
+  std::vector<order> const& orders () const noexcept;
+
+  /* Name of the collating sequence the constraint compares with */
+  char const* collation (ptrdiff_t) const noexcept;
+  /* Bitmask of the columns the statement reads. The last bit covers every column past 62 */
+  u64 columns () const noexcept;
+
+  sqlite3_index_info* get () const noexcept;
+
+private:
+  view_ptr<sqlite3_index_info> info;
+  std::vector<constraint> restraints;
+  std::vector<order> ordering;
+};
+
+/** @brief The plan table::access picks for an index::input.
+ *
+ * `usages` has one entry per constraint of the input, in the same order. The
+ * number and label are passed back as-is to cursor::filter, and are the only
+ * way the plan reaches the cursor.
+ */
+struct index::output final {
+  std::vector<usage> usages;
+  std::string label;
+  f64 cost { };
+  i64 rows { };
+  i32 number { };
+  /* The cursor returns rows in the order asked for */
+  bool ordered { false };
+  /* At most one row is returned */
+  bool unique { false };
+};
+
+struct filter final {
+  filter (i32, char const*) noexcept;
+
+  std::string_view label () const noexcept;
+  i32 number () const noexcept;
+
+private:
+  char const* text;
+  i32 num;
+};
+
 struct cursor {
   cursor (cursor const&) = delete;
   cursor (cursor&&) = delete;
@@ -76,6 +136,7 @@ struct cursor {
   cursor& operator = (cursor&&) = delete;
 
   // replace 'any' with any::random_access_range<value>
+  /* The any holds a span<value const> */
   virtual void filter (filter const&, std::any) noexcept(false) = 0;
   virtual void column (context&, i32) noexcept(false) = 0;
   virtual void next () noexcept(false) = 0;
@@ -97,6 +158,7 @@ struct table {
   virtual std::shared_ptr<table> clone () const noexcept(false) = 0;
 
   // TODO: use any::random_access_range<char const*>
+  /* The any holds a span<char const* const> of the module arguments */
   virtual void connect (std::any) noexcept(false) = 0;
   // TODO: use any::random_access_range<char const*>
   virtual void create (std::any) noexcept(false) = 0;
@@ -120,10 +182,11 @@ struct table {
   void plugin (char const*) noexcept(false);
   void name (char const*) noexcept(false);
 
+  /* The pointer is stable for as long as the table lives */
   function_type* save (function_type&&) noexcept(false);
   sqlite3_module* module () const noexcept;
 private:
-  std::vector<function_type> functions;
+  std::deque<function_type> functions;
 
   string labels;
   string mod;
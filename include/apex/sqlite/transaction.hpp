@@ -7,17 +7,36 @@
 namespace apex::sqlite {
 
 struct connection;
+struct snapshot;
 
 enum class behavior { deferred, immediate, exclusive };
 
+/** @brief A transaction that is rolled back unless it is committed.
+ *
+ * Beginning and committing can both fail (e.g., with error::resource_busy),
+ * so both throw. The destructor only ever rolls back, and ignores any error
+ * in doing so, as sqlite may already have rolled back on its own.
+ *
+ *   transaction tx { conn, behavior::immediate };
+ *   execute(conn, "UPDATE jobs SET state = 'done' WHERE id = 7");
+ *   tx.commit();
+ */
 struct transaction final {
-  transaction (connection&, behavior) noexcept;
+  transaction (connection&, behavior) noexcept(false);
+  /* A read transaction that sees the database as of the given snapshot */
+  transaction (connection&, snapshot const&) noexcept(false);
+  transaction (transaction const&) = delete;
   ~transaction () noexcept;
 
-  void release () noexcept;
+  transaction& operator = (transaction const&) = delete;
+
+  void commit () noexcept(false);
+
 private:
+  void rollback () noexcept;
+
   connection& handle;
-  bool commit;
+  bool open;
 };
 
 // TODO: savepoint should possibly instead be a function that returns an outcome
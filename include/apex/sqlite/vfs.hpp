@@ -0,0 +1,110 @@
+#ifndef APEX_SQLITE_VFS_HPP
+#define APEX_SQLITE_VFS_HPP
+
+#include <apex/core/functional.hpp>
+
+#include <apex/sqlite/histogram.hpp>
+
+#include <string_view>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <map>
+
+struct sqlite3_vfs;
+
+namespace apex::sqlite {
+
+/** @brief A VFS that batches file I/O through io_uring.
+ *
+ * Files are opened, locked, and deleted by sqlite's default unix VFS, which
+ * this wraps. Each file gets its own submission ring, which is used to:
+ *
+ *  - coalesce sequential page reads into windows of `window` bytes, with
+ *    the next window read ahead in the background while the current one is
+ *    being consumed. Windows are dropped whenever the file's locks change
+ *    (or it is written to), so they never outlive a transaction.
+ *  - submit writes to database files as they are made, without waiting for
+ *    them, with the fsync that follows ordered behind them in the ring.
+ *    Queued writes are completed before anything else touches the file
+ *    (and before any lock changes), so they are never visible out of order.
+ *
+ * Journal writes are not queued, since they must reach the kernel before the
+ * database writes that follow them. Likewise, the database's queued writes
+ * are completed before its journal is written, truncated, synced, or closed
+ * (and so deleted), even when `synchronous` is off. WAL files are left to the default VFS
+ * entirely, since their frames are published through shared memory without
+ * any call on the WAL file in between. If the kernel does not support
+ * io_uring (or it is turned off), reads are still coalesced (with pread),
+ * and writes go straight through.
+ *
+ * Every file records its read, write, and sync latency (as seen by sqlite),
+ * keyed by path, for as long as the VFS lives. The VFS must outlive every
+ * connection opened with it.
+ *
+ *   vfs uring { "apex" };
+ *   connection conn { "data.db", access::read_write, uring.name() };
+ */
+struct vfs final {
+  struct statistics;
+  struct options;
+
+  vfs (std::string, options) noexcept(false);
+  explicit vfs (std::string) noexcept(false);
+  vfs (vfs const&) = delete;
+  vfs () = delete;
+  ~vfs () noexcept;
+
+  vfs& operator = (vfs const&) = delete;
+
+  char const* name () const noexcept;
+  /* Whether io_uring is available (and wanted) */
+  bool accelerated () const noexcept;
+
+  /* Safe to call from any thread */
+  void visit (function_ref<void(std::string_view, statistics const&)>) const noexcept(false);
+  void clear () noexcept;
+
+  struct file;
+
+private:
+  friend file;
+
+  std::shared_ptr<statistics> lookup (char const*) noexcept(false);
+
+  std::unique_ptr<sqlite3_vfs> handle;
+  sqlite3_vfs* base;
+  std::string label;
+  size_t depth;
+  size_t window;
+  bool supported;
+
+  std::map<std::string, std::shared_ptr<statistics>, std::less<>> entries;
+  mutable std::mutex mutex;
+};
+
+struct vfs::options final {
+  /* Submission queue entries per file */
+  size_t depth { 64 };
+  /* Bytes per readahead window */
+  size_t window { 256 * 1024 };
+  /* Use this VFS for connections that do not name one */
+  bool preferred { false };
+  /* Use io_uring when the kernel supports it */
+  bool uring { true };
+};
+
+struct vfs::statistics final {
+  histogram reads;
+  histogram writes;
+  histogram syncs;
+  /* Reads served from a readahead window, without a syscall of their own */
+  std::atomic<u64> coalesced { };
+  /* Calls into the kernel to submit or reap I/O */
+  std::atomic<u64> submissions { };
+};
+
+} /* namespace apex::sqlite */
+
+#endif /* APEX_SQLITE_VFS_HPP */
@@ -0,0 +1,82 @@
+#ifndef APEX_CONCURRENCY_BACKOFF_HPP
+#define APEX_CONCURRENCY_BACKOFF_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) or defined(__i386__)
+  #include <immintrin.h>
+#endif /* defined(__x86_64__) or defined(__i386__) */
+
+namespace apex::concurrency {
+
+// Tells the cpu we're in a spin loop, so that it can give the other hyper
+// thread our resources (and save some electricity while it's at it).
+inline void relax () noexcept {
+#if defined(__x86_64__) or defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__) or defined(__arm__)
+  asm volatile("yield");
+#endif
+}
+
+// Exponential backoff in three stages. Each call waits a little longer than
+// the last one:
+// 1) spin for 2^N pause instructions, which stays on the cpu,
+// 2) yield to the OS scheduler, which lets someone else run on this core,
+// 3) sleep, doubling from `floor` up to `ceiling`.
+// The goal is to stay away from the scheduler for as long as the wait is
+// likely to be short, without burning a core when it is not.
+struct backoff final {
+  using duration = std::chrono::nanoseconds;
+  using clock = std::chrono::steady_clock;
+
+  struct options final {
+    unsigned spins { 6 };
+    unsigned yields { 4 };
+    duration floor { std::chrono::microseconds { 10 } };
+    duration ceiling { std::chrono::milliseconds { 1 } };
+  };
+
+  explicit backoff (options opts) noexcept : opts { opts } { }
+  backoff () noexcept : backoff { options { } } { }
+
+  void operator () () noexcept { this->operator()(clock::time_point::max()); }
+
+  // Waits, but never past the deadline. Returns false (without waiting) once
+  // it has passed.
+  bool operator () (clock::time_point deadline) noexcept {
+    auto const attempt = this->count++;
+    if (attempt < this->opts.spins) {
+      for (unsigned idx = 0; idx < (1u << std::min(attempt, 16u)); ++idx) { relax(); }
+      return clock::now() < deadline;
+    }
+    auto const now = clock::now();
+    if (now >= deadline) { return false; }
+    if (attempt < this->opts.spins + this->opts.yields) {
+      std::this_thread::yield();
+      return true;
+    }
+    std::this_thread::sleep_for(std::min<duration>(this->delay(attempt), deadline - now));
+    return true;
+  }
+
+  void reset () noexcept { this->count = 0; }
+  unsigned attempts () const noexcept { return this->count; }
+
+private:
+  duration delay (unsigned attempt) const noexcept {
+    auto const shift = std::min(attempt - this->opts.spins - this->opts.yields, 30u);
+    auto const limit = this->opts.ceiling.count() >> shift;
+    if (this->opts.floor.count() >= limit) { return this->opts.ceiling; }
+    return std::min(duration { this->opts.floor.count() << shift }, this->opts.ceiling);
+  }
+
+  options opts;
+  unsigned count { };
+};
+
+} /* namespace apex::concurrency */
+
+#endif /* APEX_CONCURRENCY_BACKOFF_HPP */
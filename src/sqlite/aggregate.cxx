@@ -0,0 +1,118 @@
+#include <apex/sqlite/aggregate.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <exception>
+#include <string>
+
+namespace {
+
+using apex::detail::sqlite::aggregator;
+using apex::sqlite::aggregated;
+using apex::sqlite::aggregate_t;
+using apex::sqlite::function_t;
+using apex::sqlite::context;
+using apex::sqlite::pure;
+
+int flags (pure deterministic) noexcept {
+  return SQLITE_UTF8 | (deterministic == pure::yes ? SQLITE_DETERMINISTIC : 0);
+}
+
+aggregator const& callbacks (sqlite3_context* ptr) noexcept {
+  return *static_cast<aggregator const*>(sqlite3_user_data(ptr));
+}
+
+void step (sqlite3_context* ptr, int argc, sqlite3_value** argv) noexcept {
+  context ctx { ptr, argc, argv };
+  try { ::callbacks(ptr).step(ctx); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+void inverse (sqlite3_context* ptr, int argc, sqlite3_value** argv) noexcept {
+  context ctx { ptr, argc, argv };
+  try { ::callbacks(ptr).inverse(ctx); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+void current (sqlite3_context* ptr) noexcept {
+  context ctx { ptr };
+  try { ::callbacks(ptr).value(ctx); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+void final (sqlite3_context* ptr) noexcept {
+  context ctx { ptr };
+  try { ::callbacks(ptr).final(ctx); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+// The plain function pointers are stored as the user data itself
+template <class T>
+T unwrap (sqlite3_context* ptr) noexcept { return reinterpret_cast<T>(sqlite3_user_data(ptr)); }
+
+void invoke (sqlite3_context* ptr, int argc, sqlite3_value** argv) noexcept {
+  context ctx { ptr, argc, argv };
+  try { ::unwrap<function_t>(ptr)(ctx); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+void accumulate (sqlite3_context* ptr, int argc, sqlite3_value** argv) noexcept {
+  context ctx { ptr, argc, argv };
+  try { ::unwrap<aggregate_t>(ptr)(ctx, aggregated::step); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+void conclude (sqlite3_context* ptr) noexcept {
+  context ctx { ptr };
+  try { ::unwrap<aggregate_t>(ptr)(ctx, aggregated::final); }
+  catch (...) { ctx = std::current_exception(); }
+}
+
+} /* nameless namespace */
+
+namespace apex::detail::sqlite {
+
+void aggregate (connection& conn, std::string_view name, ptrdiff_t argc, pure deterministic, aggregator const& item) noexcept(false) {
+  std::string const label { name };
+  auto const user = const_cast<aggregator*>(std::addressof(item));
+  auto const result = item.inverse
+    ? sqlite3_create_window_function(
+        conn.get(), label.c_str(), static_cast<int>(argc), ::flags(deterministic), user,
+        ::step, ::final, ::current, ::inverse, nullptr)
+    : sqlite3_create_function_v2(
+        conn.get(), label.c_str(), static_cast<int>(argc), ::flags(deterministic), user,
+        nullptr, ::step, ::final, nullptr);
+  if (result) { throw std::system_error(::apex::sqlite::error(result)); }
+}
+
+} /* namespace apex::detail::sqlite */
+
+namespace apex::sqlite {
+
+void aggregate (connection& conn, std::string_view name, ptrdiff_t argc, pure deterministic, aggregate_t function) noexcept(false) {
+  std::string const label { name };
+  auto const user = reinterpret_cast<void*>(function);
+  auto const result = sqlite3_create_function_v2(
+    conn.get(), label.c_str(), static_cast<int>(argc), ::flags(deterministic), user,
+    nullptr, ::accumulate, ::conclude, nullptr);
+  if (result) { throw std::system_error(error(result)); }
+}
+
+void aggregate (connection& conn, std::string_view name, ptrdiff_t argc, aggregate_t function) noexcept(false) {
+  aggregate(conn, name, argc, pure::no, function);
+}
+
+void function (connection& conn, std::string_view name, ptrdiff_t argc, pure deterministic, function_t function) noexcept(false) {
+  std::string const label { name };
+  auto const user = reinterpret_cast<void*>(function);
+  auto const result = sqlite3_create_function_v2(
+    conn.get(), label.c_str(), static_cast<int>(argc), ::flags(deterministic), user,
+    ::invoke, nullptr, nullptr, nullptr);
+  if (result) { throw std::system_error(error(result)); }
+}
+
+void function (connection& conn, std::string_view name, ptrdiff_t argc, function_t function) noexcept(false) {
+  sqlite::function(conn, name, argc, pure::no, function);
+}
+
+} /* namespace apex::sqlite */
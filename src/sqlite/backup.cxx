@@ -1,7 +1,23 @@
 #include <apex/sqlite/connection.hpp>
 #include <apex/sqlite/backup.hpp>
+#include <apex/sqlite/error.hpp>
 #include <sqlite3.h>
 
+#include <thread>
+
+namespace {
+
+bool is_contended (int result) noexcept {
+  return result == SQLITE_BUSY or result == SQLITE_LOCKED;
+}
+
+void rest (std::chrono::nanoseconds duration) noexcept {
+  if (duration.count() > 0) { return std::this_thread::sleep_for(duration); }
+  std::this_thread::yield();
+}
+
+} /* nameless namespace */
+
 namespace apex::sqlite {
 
 backup::backup (connection& dst, zstring_view dst_name,
@@ -9,23 +25,101 @@ backup::backup (connection& dst, zstring_view dst_name,
   resource_type {
     sqlite3_backup_init(dst.get(), dst_name.data(), src.get(), src_name.data()),
     sqlite3_backup_finish
-  }
+  },
+  done { std::make_shared<bool>(false) },
+  finished { false }
+{
+  // The error is left on the destination connection
+  if (not this->get()) { throw std::system_error(error(sqlite3_errcode(dst.get()))); }
+}
+
+backup::backup (connection& dst, connection const& src) noexcept(false) :
+  backup { dst, "main", src, "main" }
 { }
 
-backup const& backup::read_from () noexcept { return *this; }
+void backup::swap (backup& that) noexcept {
+  using std::swap;
+  swap(static_cast<resource_type&>(*this), static_cast<resource_type&>(that));
+  swap(this->done, that.done);
+  swap(this->stride, that.stride);
+  swap(this->finished, that.finished);
+}
+
+int backup::advance (ptrdiff_t pages) noexcept(false) {
+  if (not this->done or *this->done) { return SQLITE_DONE; }
+  auto result = sqlite3_backup_step(this->get(), static_cast<int>(pages));
+  if (result == SQLITE_DONE) { *this->done = true; }
+  else if (result != SQLITE_OK and not ::is_contended(result)) {
+    throw std::system_error(error(result));
+  }
+  return result;
+}
+
+bool backup::step (ptrdiff_t pages) noexcept(false) {
+  if (this->is_finished()) { return false; }
+  if (this->advance(pages) != SQLITE_DONE) { return true; }
+  this->finished = true;
+  return false;
+}
 
-//void backup::advance (ptrdiff_t n) noexcept {
-//  auto result = sqlite3_backup_step(this->get(), n);
-//  if (result == SQLITE_OK) { return; }
-//  if (result == SQLITE_DONE) {
-//    // TODO: Set sqlite3_backup into non-iterable state
-//    // Alternatively, we just need to support some way of comparing backup
-//    // to sqlite::{error||status}::done :)
-//  }
-//  // TODO: handle cases where a step has 'failed'
-//}
+void backup::run (throttle const& pace, progress_type progress) noexcept(false) {
+  using clock = std::chrono::steady_clock;
+  auto pages = pace.pages ? pace.pages : 1;
+  auto moved = clock::now();
+  while (not this->is_finished()) {
+    auto result = this->advance(pages);
+    if (result == SQLITE_DONE) {
+      this->finished = true;
+      return progress(*this);
+    }
+    if (result == SQLITE_OK) {
+      moved = clock::now();
+      progress(*this);
+    } else if (clock::now() - moved > pace.patience) {
+      throw std::system_error(error(result));
+    }
+    ::rest(pace.pause);
+  }
+}
+
+void backup::run (throttle const& pace) noexcept(false) {
+  this->run(pace, [] (backup const&) noexcept { });
+}
+
+iterable<backup> backup::steps (ptrdiff_t pages) noexcept(false) {
+  backup start { *this };
+  start.stride = pages ? pages : 1;
+  start.next();
+  return iterable<backup> { std::move(start), backup { } };
+}
+
+backup const& backup::read_from () const noexcept { return *this; }
+
+ptrdiff_t backup::distance_to (backup const& that) const noexcept {
+  return this->remaining() - that.remaining();
+}
+
+void backup::next () noexcept(false) {
+  if (not this->done or *this->done) {
+    this->finished = true;
+    return;
+  }
+  this->advance(this->stride);
+}
+
+bool backup::equals (backup const& that) const noexcept {
+  if (this->is_finished() or that.is_finished()) {
+    return this->is_finished() == that.is_finished();
+  }
+  return this->get() == that.get() and this->remaining() == that.remaining();
+}
+
+bool backup::is_finished () const noexcept {
+  return this->finished or not this->get();
+}
 
 ptrdiff_t backup::remaining () const noexcept {
+  if (this->is_finished()) { return 0; }
   return sqlite3_backup_remaining(this->get());
 }
 
@@ -34,6 +128,7 @@ ptrdiff_t backup::copied () const noexcept {
 }
 
 ptrdiff_t backup::total () const noexcept {
+  if (not this->get()) { return 0; }
   return sqlite3_backup_pagecount(this->get());
 }
 
@@ -0,0 +1,194 @@
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/batch.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/core/bit.hpp>
+#include <sqlite3.h>
+
+#include <utility>
+#include <limits>
+
+namespace {
+
+constexpr size_t bits = 64;
+
+constexpr size_t words (size_t count) noexcept { return (count + bits - 1) / bits; }
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+size_t batch::columns () const noexcept { return this->fields.size(); }
+size_t batch::size () const noexcept { return this->rows; }
+bool batch::empty () const noexcept { return not this->rows; }
+
+affinity batch::type (size_t column) const noexcept { return this->fields[column].kind; }
+
+span<i64 const> batch::integers (size_t column) const noexcept {
+  auto const& items = this->fields[column].integers;
+  return { items.data(), items.empty() ? 0 : this->rows };
+}
+
+span<f64 const> batch::reals (size_t column) const noexcept {
+  auto const& items = this->fields[column].reals;
+  return { items.data(), items.empty() ? 0 : this->rows };
+}
+
+span<u32 const> batch::offsets (size_t column) const noexcept {
+  auto const& items = this->fields[column].offsets;
+  return { items.data(), items.empty() ? 0 : this->rows + 1 };
+}
+
+std::string_view batch::arena (size_t column) const noexcept {
+  return this->fields[column].arena;
+}
+
+std::string_view batch::text (size_t column, size_t row) const noexcept {
+  auto const& item = this->fields[column];
+  auto const start = item.offsets[row];
+  return std::string_view { item.arena }.substr(start, item.offsets[row + 1] - start);
+}
+
+span<u64 const> batch::nulls (size_t column) const noexcept {
+  return { this->fields[column].nulls.data(), words(this->rows) };
+}
+
+span<u64 const> batch::integral (size_t column) const noexcept {
+  auto const& items = this->fields[column].integral;
+  return { items.data(), items.empty() ? 0 : words(this->rows) };
+}
+
+bool batch::is_integral (size_t column, size_t row) const noexcept {
+  auto const& items = this->fields[column].integral;
+  return not items.empty() and ((items[row / bits] >> (row % bits)) & 1);
+}
+
+size_t batch::null_count (size_t column) const noexcept {
+  size_t count = 0;
+  for (auto word : this->nulls(column)) { count += static_cast<size_t>(popcount(word)); }
+  return count;
+}
+
+bool batch::is_null (size_t column, size_t row) const noexcept {
+  return (this->fields[column].nulls[row / bits] >> (row % bits)) & 1;
+}
+
+void batch::clear () noexcept {
+  this->source = nullptr;
+  this->finished = false;
+  this->rows = 0;
+  this->run = 0;
+}
+
+// Columns without a declared type have no affinity until the first row has
+// been stepped, at which point the value's own type is used. That can differ
+// from run to run, so the layout is rebuilt whenever a run starts that the
+// batch did not see start (e.g., once the statement is reset, or when a
+// different statement now lives at the same address).
+size_t fetch (statement& stmt, batch& into, size_t count) noexcept(false) {
+  auto handle = stmt.get();
+  auto runs = [handle] { return sqlite3_stmt_status(handle, SQLITE_STMTSTATUS_RUN, 0); };
+  auto layout = [&into, handle] {
+    auto const columns = static_cast<size_t>(sqlite3_column_count(handle));
+    into.fields.resize(columns);
+    for (size_t idx = 0; idx < columns; ++idx) {
+      auto& field = into.fields[idx];
+      field.kind = column { handle, static_cast<ptrdiff_t>(idx) }.type();
+      field.deferred = not sqlite3_column_decltype(handle, static_cast<int>(idx));
+      field.integers.clear();
+      field.reals.clear();
+      field.offsets.clear();
+      field.integral.clear();
+    }
+  };
+  if (into.source != view_ptr { handle } or into.run != runs()) {
+    layout();
+    into.source = handle;
+    into.run = runs();
+    into.finished = false;
+  }
+  into.rows = 0;
+  // Owed once, so that sqlite does not restart the statement in a loop that
+  // fetches until nothing is left
+  if (std::exchange(into.finished, false)) { return 0; }
+
+  auto reserve = [count] (auto& field) {
+    field.nulls.assign(words(count), 0);
+    switch (field.kind) {
+      case affinity::integer: field.integers.resize(count); break;
+      case affinity::real: field.reals.resize(count); break;
+      case affinity::numeric:
+        field.integers.resize(count);
+        field.reals.resize(count);
+        field.integral.assign(words(count), 0);
+        break;
+      case affinity::text: [[fallthrough]];
+      case affinity::blob:
+        field.offsets.resize(count + 1);
+        field.offsets.front() = 0;
+        field.arena.clear();
+        break;
+    }
+  };
+  for (auto& field : into.fields) { reserve(field); }
+
+  while (into.rows < count) {
+    auto result = sqlite3_step(handle);
+    if (result == SQLITE_DONE) {
+      into.finished = true;
+      break;
+    }
+    if (result != SQLITE_ROW) { throw std::system_error(error(result)); }
+    if (into.run != runs()) {
+      layout();
+      for (auto& field : into.fields) { reserve(field); }
+      into.run = runs();
+    }
+    auto const row = into.rows++;
+    for (size_t idx = 0; idx < into.fields.size(); ++idx) {
+      auto& field = into.fields[idx];
+      auto const column = static_cast<int>(idx);
+      auto const type = sqlite3_column_type(handle, column);
+      if (field.deferred) {
+        switch (type) {
+          case SQLITE_INTEGER: field.kind = affinity::integer; break;
+          case SQLITE_FLOAT: field.kind = affinity::real; break;
+          case SQLITE_TEXT: field.kind = affinity::text; break;
+          case SQLITE_BLOB: field.kind = affinity::blob; break;
+          default: field.kind = affinity::numeric; break;
+        }
+        field.deferred = false;
+        field.offsets.clear();
+        reserve(field);
+      }
+      auto const null = type == SQLITE_NULL;
+      if (null) { field.nulls[row / bits] |= u64 { 1 } << (row % bits); }
+      switch (field.kind) {
+        case affinity::integer:
+          field.integers[row] = null ? 0 : sqlite3_column_int64(handle, column);
+          break;
+        case affinity::real:
+          field.reals[row] = null ? 0.0 : sqlite3_column_double(handle, column);
+          break;
+        case affinity::numeric:
+          field.integers[row] = null ? 0 : sqlite3_column_int64(handle, column);
+          field.reals[row] = null ? 0.0 : sqlite3_column_double(handle, column);
+          if (type == SQLITE_INTEGER) { field.integral[row / bits] |= u64 { 1 } << (row % bits); }
+          break;
+        case affinity::text: [[fallthrough]];
+        case affinity::blob: {
+          auto const data = static_cast<char const*>(sqlite3_column_blob(handle, column));
+          auto const size = static_cast<size_t>(sqlite3_column_bytes(handle, column));
+          if (data) { field.arena.append(data, size); }
+          if (field.arena.size() > std::numeric_limits<u32>::max()) {
+            throw std::system_error(error::argument_length_overflow);
+          }
+          field.offsets[row + 1] = static_cast<u32>(field.arena.size());
+          break;
+        }
+      }
+    }
+  }
+  return into.rows;
+}
+
+} /* namespace apex::sqlite */
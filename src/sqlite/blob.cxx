@@ -0,0 +1,133 @@
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/blob.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+namespace {
+
+using apex::i64;
+
+void check (int result) noexcept(false) {
+  if (result) { throw std::system_error(apex::sqlite::error(result)); }
+}
+
+/* sqlite3_blob_read and sqlite3_blob_write take an int */
+int clamp (size_t size) noexcept {
+  return static_cast<int>(std::min<size_t>(size, std::numeric_limits<int>::max()));
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+void default_delete<sqlite3_blob>::operator () (sqlite3_blob* ptr) noexcept {
+  sqlite3_blob_close(ptr);
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, zeroblob blob) noexcept(false) {
+  auto const size = static_cast<sqlite3_uint64>(blob.size);
+  ::check(sqlite3_bind_zeroblob64(stmt.get(), static_cast<int>(idx), size));
+}
+
+blob::blob (connection& conn, zstring_view schema, zstring_view table, zstring_view column, i64 row, access mode) noexcept(false) :
+  resource_type { }
+{
+  sqlite3_blob* ptr = nullptr;
+  auto const flags = mode == access::read_write ? 1 : 0;
+  auto const result = sqlite3_blob_open(conn.get(), schema.data(), table.data(), column.data(), row, flags, &ptr);
+  this->storage.reset(ptr);
+  ::check(result);
+}
+
+blob::blob (connection& conn, zstring_view table, zstring_view column, i64 row, access mode) noexcept(false) :
+  blob { conn, "main", table, column, row, mode }
+{ }
+
+blob::blob (connection& conn, zstring_view table, zstring_view column, i64 row) noexcept(false) :
+  blob { conn, table, column, row, access::read_only }
+{ }
+
+void blob::swap (blob& that) noexcept {
+  using std::swap;
+  swap(static_cast<resource_type&>(*this), static_cast<resource_type&>(that));
+  swap(this->position, that.position);
+}
+
+void blob::reopen (i64 row) noexcept(false) {
+  ::check(sqlite3_blob_reopen(this->get(), row));
+  this->position = 0;
+}
+
+span<byte> blob::read (span<byte> buffer, i64 offset) const noexcept(false) {
+  if (offset < 0 or offset > this->size()) {
+    throw std::system_error(error::argument_out_of_range);
+  }
+  auto const available = static_cast<size_t>(this->size() - offset);
+  auto const count = ::clamp(std::min(buffer.size(), available));
+  if (count) { ::check(sqlite3_blob_read(this->get(), buffer.data(), count, static_cast<int>(offset))); }
+  return buffer.first(static_cast<size_t>(count));
+}
+
+span<byte> blob::read (span<byte> buffer) noexcept(false) {
+  auto filled = std::as_const(*this).read(buffer, this->position);
+  this->position += static_cast<i64>(filled.size());
+  return filled;
+}
+
+void blob::write (span<byte const> buffer, i64 offset) noexcept(false) {
+  auto const size = static_cast<i64>(buffer.size());
+  if (offset < 0 or size > this->size() - offset) {
+    throw std::system_error(error::argument_out_of_range);
+  }
+  if (buffer.empty()) { return; }
+  ::check(sqlite3_blob_write(this->get(), buffer.data(), static_cast<int>(size), static_cast<int>(offset)));
+}
+
+void blob::write (span<byte const> buffer) noexcept(false) {
+  this->write(buffer, this->position);
+  this->position += static_cast<i64>(buffer.size());
+}
+
+i64 blob::seek (i64 offset, whence from) noexcept(false) {
+  auto base = this->position;
+  if (from == whence::begin) { base = 0; }
+  if (from == whence::end) { base = this->size(); }
+  auto const target = base + offset;
+  if (target < 0 or target > this->size()) {
+    throw std::system_error(error::argument_out_of_range);
+  }
+  return this->position = target;
+}
+
+i64 blob::tell () const noexcept { return this->position; }
+i64 blob::size () const noexcept { return sqlite3_blob_bytes(this->get()); }
+
+iterable<blob::chunk> blob::chunks (span<byte> buffer) noexcept(false) {
+  return { chunk { *this, buffer }, chunk { } };
+}
+
+blob::chunk::chunk (blob& source, span<byte> buffer) noexcept(false) :
+  source { std::addressof(source) },
+  buffer { buffer }
+{ ++*this; }
+
+blob::chunk& blob::chunk::operator ++ () noexcept(false) {
+  // An empty buffer would never make progress
+  if (this->buffer.empty()) { this->current = { }; }
+  else { this->current = this->source->read(this->buffer); }
+  return *this;
+}
+
+/* Every chunk that has run out is the end */
+bool blob::chunk::operator == (chunk const& that) const noexcept {
+  if (this->current.empty() or that.current.empty()) {
+    return this->current.empty() == that.current.empty();
+  }
+  return this->source == that.source;
+}
+
+} /* namespace apex::sqlite */
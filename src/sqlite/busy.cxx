@@ -0,0 +1,56 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/busy.hpp>
+#include <sqlite3.h>
+
+namespace apex::sqlite {
+
+busy::busy (connection& conn, duration budget, options opts) noexcept(false) :
+  guarded { conn },
+  wait { opts },
+  budget { budget }
+{
+  if (auto result = sqlite3_busy_handler(conn.get(), &busy::retry, this)) {
+    throw std::system_error(error(result));
+  }
+}
+
+busy::busy (connection& conn, duration budget) noexcept(false) :
+  busy { conn, budget, defaults }
+{ }
+
+busy::~busy () noexcept {
+  sqlite3_busy_handler(this->guarded.get(), nullptr, nullptr);
+}
+
+busy::statistics const& busy::stats () const noexcept { return this->counters; }
+
+int busy::retry (void* ptr, int count) noexcept {
+  return (*static_cast<busy*>(ptr))(count);
+}
+
+// sqlite passes zero the first time a lock is found busy, and counts up for
+// as long as it keeps retrying that same lock. A wait that did not time out
+// is only known to be over once the next one starts.
+bool busy::operator () (int count) noexcept {
+  auto const now = concurrency::backoff::clock::now();
+  if (count == 0) {
+    if (this->waiting) { this->counters.waits.record(this->granted - this->started); }
+    this->wait.reset();
+    this->started = now;
+    this->deadline = now + this->budget;
+    this->counters.contended.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (not this->wait(this->deadline)) {
+    this->counters.waits.record(now - this->started);
+    this->counters.timeouts.fetch_add(1, std::memory_order_relaxed);
+    this->waiting = false;
+    return false;
+  }
+  this->granted = concurrency::backoff::clock::now();
+  this->waiting = true;
+  this->counters.retries.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+} /* namespace apex::sqlite */
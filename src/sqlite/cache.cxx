@@ -0,0 +1,104 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/cache.hpp>
+
+#include <utility>
+
+namespace apex::sqlite {
+
+cache::cache (size_t limit) noexcept :
+  limit { limit }
+{ }
+
+// SQLite's own tcl interface defaults to a cache of 10, which is a little on
+// the low side once savepoints get involved.
+cache::cache () noexcept :
+  cache { 32 }
+{ }
+
+cache::lease cache::acquire (connection& conn, std::string_view sql) noexcept(false) {
+  if (auto found = this->index.find(sql); found != this->index.end()) {
+    auto entry = found->second;
+    if (not entry->busy) {
+      this->entries.splice(this->entries.begin(), this->entries, entry);
+      entry->busy = true;
+      ++this->counters.hits;
+      return lease { *this, entry, { } };
+    }
+  }
+  ++this->counters.misses;
+  auto tail = sql;
+  statement stmt { conn, tail };
+  this->entries.push_front(node { std::string { sql }, std::move(stmt), true });
+  auto entry = this->entries.begin();
+  if (tail.empty() and entry->stmt) { this->index.try_emplace(entry->sql, entry); }
+  this->trim();
+  return lease { *this, entry, tail };
+}
+
+void cache::capacity (size_t limit) noexcept {
+  this->limit = limit;
+  this->trim();
+}
+
+size_t cache::capacity () const noexcept { return this->limit; }
+size_t cache::size () const noexcept { return this->index.size(); }
+
+cache::statistics const& cache::stats () const noexcept { return this->counters; }
+
+void cache::clear () noexcept {
+  for (auto entry = this->entries.begin(); entry != this->entries.end();) {
+    if (entry->busy) {
+      ++entry;
+      continue;
+    }
+    this->index.erase(entry->sql);
+    entry = this->entries.erase(entry);
+  }
+}
+
+void cache::release (iterator entry) noexcept {
+  entry->stmt.reset();
+  entry->stmt.clear();
+  entry->busy = false;
+  auto found = this->index.find(entry->sql);
+  if (found == this->index.end() or found->second != entry) {
+    this->entries.erase(entry);
+    return;
+  }
+  this->trim();
+}
+
+void cache::trim () noexcept {
+  auto entry = this->entries.end();
+  while (this->index.size() > this->limit and entry != this->entries.begin()) {
+    if ((--entry)->busy) { continue; }
+    this->index.erase(entry->sql);
+    entry = this->entries.erase(entry);
+    ++this->counters.evictions;
+  }
+}
+
+cache::lease::lease (cache& owner, iterator entry, std::string_view rest) noexcept :
+  owner { std::addressof(owner) },
+  entry { entry },
+  rest { rest }
+{ }
+
+cache::lease::lease (lease&& that) noexcept :
+  owner { std::exchange(that.owner, nullptr) },
+  entry { that.entry },
+  rest { that.rest }
+{ }
+
+cache::lease::~lease () noexcept {
+  if (this->owner) { this->owner->release(this->entry); }
+}
+
+statement& cache::lease::operator * () const noexcept { return this->entry->stmt; }
+statement* cache::lease::operator -> () const noexcept {
+  return std::addressof(this->entry->stmt);
+}
+
+std::string_view cache::lease::tail () const noexcept { return this->rest; }
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,136 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/changeset.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <utility>
+
+namespace {
+
+using apex::sqlite::conflict;
+using apex::byte;
+
+// Takes ownership of a buffer sqlite allocated
+std::vector<byte> adopt (void* data, int size) noexcept(false) {
+  struct release final {
+    ~release () noexcept { sqlite3_free(this->data); }
+    void* data;
+  } guard { data };
+  auto const bytes = static_cast<byte const*>(data);
+  return std::vector<byte>(bytes, bytes + size);
+}
+
+int resolve (void* ptr, int kind, sqlite3_changeset_iter*) noexcept {
+  switch (*static_cast<conflict const*>(ptr)) {
+    case conflict::ignore: return SQLITE_CHANGESET_OMIT;
+    case conflict::replace:
+      switch (kind) {
+        case SQLITE_CHANGESET_DATA:
+        case SQLITE_CHANGESET_CONFLICT: return SQLITE_CHANGESET_REPLACE;
+        case SQLITE_CHANGESET_NOTFOUND: return SQLITE_CHANGESET_OMIT;
+        default: return SQLITE_CHANGESET_ABORT;
+      }
+    case conflict::rollback:
+    case conflict::fail:
+    case conflict::abort: break;
+  }
+  return SQLITE_CHANGESET_ABORT;
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+void default_delete<sqlite3_session>::operator () (sqlite3_session* ptr) noexcept {
+  sqlite3session_delete(ptr);
+}
+
+changeset::changeset (std::vector<byte> bytes) noexcept :
+  bytes { std::move(bytes) }
+{ }
+
+span<byte const> changeset::data () const noexcept { return { this->bytes.data(), this->bytes.size() }; }
+size_t changeset::size () const noexcept { return this->bytes.size(); }
+bool changeset::empty () const noexcept { return this->bytes.empty(); }
+
+changeset& changeset::operator += (changeset const& that) noexcept(false) {
+  if (that.empty()) { return *this; }
+  if (this->empty()) { return *this = that; }
+  int size = 0;
+  void* data = nullptr;
+  auto result = sqlite3changeset_concat(
+    static_cast<int>(this->bytes.size()), this->bytes.data(),
+    static_cast<int>(that.bytes.size()), const_cast<byte*>(that.bytes.data()),
+    &size, &data);
+  if (result) {
+    sqlite3_free(data);
+    throw std::system_error(error(result));
+  }
+  this->bytes = ::adopt(data, size);
+  return *this;
+}
+
+recorder::recorder (connection& conn, std::string_view schema) noexcept(false) :
+  resource_type { },
+  handle { conn },
+  schema { schema }
+{ this->start(); }
+
+recorder::recorder (connection& conn) noexcept(false) :
+  recorder { conn, "main" }
+{ }
+
+void recorder::attach (std::string_view table) noexcept(false) {
+  auto const first = this->tables.empty();
+  auto const& name = this->tables.emplace_back(table);
+  if (first) { return this->start(); }
+  if (auto result = sqlite3session_attach(this->get(), name.c_str())) {
+    this->tables.pop_back();
+    throw std::system_error(error(result));
+  }
+}
+
+bool recorder::empty () const noexcept { return sqlite3session_isempty(this->get()); }
+
+// sqlite has no way to clear a session, so a new one takes its place. Any
+// changes made inside an open transaction would be lost (or flushed before
+// they were committed), so that is not allowed.
+changeset recorder::flush () noexcept(false) {
+  if (not sqlite3_get_autocommit(this->handle.get())) {
+    throw std::system_error(error::inappropriate_operation);
+  }
+  if (this->empty()) { return { }; }
+  int size = 0;
+  void* data = nullptr;
+  if (auto result = sqlite3session_changeset(this->get(), &size, &data)) {
+    sqlite3_free(data);
+    throw std::system_error(error(result));
+  }
+  changeset delta { ::adopt(data, size) };
+  this->start();
+  return delta;
+}
+
+void recorder::start () noexcept(false) {
+  sqlite3_session* session = nullptr;
+  auto result = sqlite3session_create(this->handle.get(), this->schema.c_str(), &session);
+  if (result) { throw std::system_error(error(result)); }
+  std::unique_ptr<sqlite3_session, default_delete<sqlite3_session>> item { session };
+  if (this->tables.empty()) { result = sqlite3session_attach(session, nullptr); }
+  for (auto const& name : this->tables) {
+    if (result) { break; }
+    result = sqlite3session_attach(session, name.c_str());
+  }
+  if (result) { throw std::system_error(error(result)); }
+  this->storage = std::move(item);
+}
+
+void apply (connection& conn, changeset const& delta, conflict policy) noexcept(false) {
+  if (delta.empty()) { return; }
+  auto const data = const_cast<byte*>(delta.data().data());
+  auto const size = static_cast<int>(delta.size());
+  auto result = sqlite3changeset_apply(conn.get(), size, data, nullptr, ::resolve, &policy);
+  if (result) { throw std::system_error(error(result)); }
+}
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,160 @@
+#include <apex/sqlite/checkpointer.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+
+namespace {
+
+using apex::sqlite::connection;
+using apex::sqlite::checkpoint;
+
+static_assert(static_cast<int>(checkpoint::passive) == SQLITE_CHECKPOINT_PASSIVE);
+static_assert(static_cast<int>(checkpoint::full) == SQLITE_CHECKPOINT_FULL);
+static_assert(static_cast<int>(checkpoint::restart) == SQLITE_CHECKPOINT_RESTART);
+static_assert(static_cast<int>(checkpoint::truncate) == SQLITE_CHECKPOINT_TRUNCATE);
+
+// Runs a pragma that reports its value as a single row, and returns it as text
+std::string pragma (connection& conn, std::string_view sql) noexcept(false) {
+  auto stmt = conn.prepare(sql);
+  std::string value;
+  auto result = sqlite3_step(stmt->get());
+  if (result == SQLITE_ROW) {
+    if (auto text = sqlite3_column_text(stmt->get(), 0)) { value = reinterpret_cast<char const*>(text); }
+    result = SQLITE_DONE;
+  }
+  stmt->reset();
+  if (result != SQLITE_DONE) { throw std::system_error(apex::sqlite::error(result)); }
+  return value;
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+checkpointer::checkpointer (connection& conn, std::filesystem::path const& path, thresholds limits) noexcept(false) :
+  watched { conn },
+  background { path, access::read_write },
+  limits { limits }
+{
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  auto const patience = duration_cast<milliseconds>(limits.patience).count();
+  sqlite3_busy_timeout(this->background.get(), static_cast<int>(patience));
+  // Switching the journal mode is left to whoever owns the database. This
+  // also makes the connection read the database, without which it would not
+  // know it is in WAL mode, and every checkpoint would silently do nothing.
+  if (::pragma(this->background, "PRAGMA journal_mode") != "wal") {
+    throw std::system_error(error::inappropriate_operation);
+  }
+  auto const interval = ::pragma(this->watched, "PRAGMA wal_autocheckpoint");
+  std::from_chars(interval.data(), interval.data() + interval.size(), this->previous);
+  this->worker = std::thread { [this] { this->run(); } };
+  // Only installed once nothing else can throw, as the destructor removes it
+  sqlite3_wal_hook(this->watched.get(), &checkpointer::notify, this);
+}
+
+checkpointer::checkpointer (connection& conn, std::filesystem::path const& path) noexcept(false) :
+  checkpointer { conn, path, thresholds { } }
+{ }
+
+checkpointer::~checkpointer () noexcept {
+  // This also removes our hook
+  sqlite3_wal_autocheckpoint(this->watched.get(), this->previous);
+  {
+    std::lock_guard lock { this->mutex };
+    this->stopping = true;
+  }
+  this->wake.notify_one();
+  this->worker.join();
+}
+
+void checkpointer::request (checkpoint mode) noexcept {
+  {
+    std::lock_guard lock { this->mutex };
+    this->requested = std::max(this->requested, mode);
+    this->pending.store(true, std::memory_order_relaxed);
+  }
+  this->wake.notify_one();
+}
+
+histogram const& checkpointer::latency (checkpoint mode) const noexcept {
+  return this->latencies[static_cast<size_t>(mode)];
+}
+
+ptrdiff_t checkpointer::frames () const noexcept {
+  return this->size.load(std::memory_order_relaxed);
+}
+
+std::error_code checkpointer::failure () const noexcept {
+  if (auto result = this->status.load(std::memory_order_relaxed)) { return sqlite::error(result); }
+  return { };
+}
+
+// Runs on every commit, so the lock is only taken when a checkpoint is due
+// and the background thread is not already on its way. Past the truncate
+// threshold, a steady stream of commits would starve the checkpoint of the
+// write lock it needs, so the committing thread waits (with no locks held)
+// for the checkpoint to finish, up to the configured patience.
+int checkpointer::notify (void* data, sqlite3*, char const*, int frames) noexcept {
+  auto self = static_cast<checkpointer*>(data);
+  self->size.store(frames, std::memory_order_relaxed);
+  if (frames < self->limits.passive) { return SQLITE_OK; }
+  if (frames < self->limits.truncate) {
+    if (self->pending.load(std::memory_order_relaxed)) { return SQLITE_OK; }
+    {
+      std::lock_guard lock { self->mutex };
+      self->pending.store(true, std::memory_order_relaxed);
+    }
+    self->wake.notify_one();
+    return SQLITE_OK;
+  }
+  std::unique_lock lock { self->mutex };
+  // A checkpoint already under way may have started before our commit
+  auto const generation = self->completed + (self->running ? 2 : 1);
+  self->requested = checkpoint::truncate;
+  self->pending.store(true, std::memory_order_relaxed);
+  self->wake.notify_one();
+  self->finished.wait_for(lock, self->limits.patience * 2, [self, generation] {
+    return self->stopping or self->completed >= generation;
+  });
+  return SQLITE_OK;
+}
+
+void checkpointer::run () noexcept {
+  std::unique_lock lock { this->mutex };
+  while (true) {
+    this->wake.wait(lock, [this] {
+      return this->stopping or this->pending.load(std::memory_order_relaxed);
+    });
+    if (this->stopping) { return; }
+    // Cleared up front, so commits (and requests) made while the checkpoint
+    // runs will schedule another one.
+    this->pending.store(false, std::memory_order_relaxed);
+    auto mode = std::exchange(this->requested, checkpoint::passive);
+    this->running = true;
+    lock.unlock();
+
+    auto const frames = this->size.load(std::memory_order_relaxed);
+    if (frames >= this->limits.truncate) { mode = checkpoint::truncate; }
+    else if (frames >= this->limits.restart) { mode = std::max(mode, checkpoint::restart); }
+
+    int log = 0;
+    int copied = 0;
+    auto const start = std::chrono::steady_clock::now();
+    auto result = sqlite3_wal_checkpoint_v2(this->background.get(), nullptr, static_cast<int>(mode), &log, &copied);
+    this->latencies[static_cast<size_t>(mode)].record(std::chrono::steady_clock::now() - start);
+    // Busy just means readers held us back, and the next commit retries
+    if (result != SQLITE_OK and result != SQLITE_BUSY) {
+      this->status.store(result, std::memory_order_relaxed);
+    }
+    lock.lock();
+    this->running = false;
+    ++this->completed;
+    this->finished.notify_all();
+  }
+}
+
+} /* namespace apex::sqlite */
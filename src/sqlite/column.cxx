@@ -2,8 +2,26 @@
 #include <apex/core/prelude.hpp>
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+bool contains (std::string_view haystack, std::string_view needle) noexcept {
+  auto equal = [] (char x, char y) noexcept { return std::toupper(x) == std::toupper(y); };
+  auto found = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), equal);
+  return found != haystack.end();
+}
+
+} /* nameless namespace */
+
 namespace apex::sqlite {
 
+column::column (pointer stmt, ptrdiff_t idx) noexcept :
+  resource_type { stmt },
+  idx { idx }
+{ }
+
 void swap (column& lhs, column& rhs) noexcept {
   ranges::swap(lhs.idx, rhs.idx);
 }
@@ -36,4 +54,21 @@ zstring_view column::name () const noexcept {
 
 ptrdiff_t column::index () const noexcept { return this->idx; }
 
+// These are the rules from section 3.1 of https://sqlite.org/datatype3.html,
+// and are applied in this exact order.
+affinity column::type () const noexcept {
+  auto text = sqlite3_column_decltype(this->get(), static_cast<int>(this->index()));
+  if (not text) { return affinity::blob; }
+  std::string_view declared { text };
+  if (contains(declared, "INT")) { return affinity::integer; }
+  if (contains(declared, "CHAR")) { return affinity::text; }
+  if (contains(declared, "CLOB")) { return affinity::text; }
+  if (contains(declared, "TEXT")) { return affinity::text; }
+  if (contains(declared, "BLOB") or declared.empty()) { return affinity::blob; }
+  if (contains(declared, "REAL")) { return affinity::real; }
+  if (contains(declared, "FLOA")) { return affinity::real; }
+  if (contains(declared, "DOUB")) { return affinity::real; }
+  return affinity::numeric;
+}
+
 } /* namespace apex::sqlite */
@@ -0,0 +1,495 @@
+#include <apex/sqlite/columnar.hpp>
+#include <apex/sqlite/planner.hpp>
+#include <apex/sqlite/context.hpp>
+#include <apex/sqlite/value.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/core/span.hpp>
+#include <sqlite3.h>
+
+#include <functional>
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <numeric>
+#include <limits>
+#include <cmath>
+
+namespace {
+
+using apex::sqlite::restraint;
+using apex::sqlite::columnar;
+using apex::sqlite::error;
+using apex::i32;
+using apex::i64;
+using apex::u32;
+using apex::f64;
+
+/* Positions of a block's smallest and largest values */
+struct zone final {
+  u32 low;
+  u32 high;
+};
+
+using bound_type = std::variant<i64, f64, std::string>;
+
+struct term final {
+  i32 column;
+  restraint op;
+  bound_type bound;
+};
+
+// Rewrites a comparison of an integer column against a real into one
+// against an integer that keeps the same rows. Anything else that cannot be
+// compared exactly (NULL, text, blob, NaN, or reals out of range) is not
+// used at all.
+std::optional<std::pair<restraint, i64>> integral (restraint op, sqlite3_value* item) noexcept {
+  auto const type = sqlite3_value_type(item);
+  if (type == SQLITE_INTEGER) { return std::pair { op, sqlite3_value_int64(item) }; }
+  if (type != SQLITE_FLOAT) { return std::nullopt; }
+  // 2^63, the first real past the range of an i64
+  constexpr f64 limit = 9223372036854775808.0;
+  auto const number = sqlite3_value_double(item);
+  if (not (number > -limit and number < limit)) { return std::nullopt; }
+  auto const down = static_cast<i64>(std::floor(number));
+  auto const up = static_cast<i64>(std::ceil(number));
+  switch (op) {
+    case restraint::greater: return std::pair { op, down };
+    case restraint::less_equal: return std::pair { op, down };
+    case restraint::greater_equal: return std::pair { op, up };
+    case restraint::less: return std::pair { op, up };
+    case restraint::equal_to:
+      if (down == up) { return std::pair { op, down }; }
+      return std::pair { restraint::less, std::numeric_limits<i64>::min() };
+    default: return std::nullopt;
+  }
+}
+
+std::optional<f64> real (sqlite3_value* item) noexcept {
+  // Integers past 2^53 would be rounded
+  constexpr i64 exact = i64 { 1 } << 53;
+  switch (sqlite3_value_type(item)) {
+    case SQLITE_FLOAT: {
+      auto const number = sqlite3_value_double(item);
+      if (std::isnan(number)) { return std::nullopt; }
+      return number;
+    }
+    case SQLITE_INTEGER: {
+      auto const number = sqlite3_value_int64(item);
+      if (number < -exact or number > exact) { return std::nullopt; }
+      return static_cast<f64>(number);
+    }
+    default: return std::nullopt;
+  }
+}
+
+/* NaNs are ordered first, so that sorting has a strict weak order */
+struct before final {
+  template <class T>
+  bool operator () (T const& lhs, T const& rhs) const noexcept {
+    if constexpr (std::is_floating_point_v<T>) {
+      if (std::isnan(lhs)) { return not std::isnan(rhs); }
+      if (std::isnan(rhs)) { return false; }
+    }
+    return lhs < rhs;
+  }
+};
+
+template <class T, class B>
+bool excludes (restraint op, T const& low, T const& high, B const& bound) noexcept {
+  switch (op) {
+    case restraint::equal_to: return bound < low or high < bound;
+    case restraint::greater: return high <= bound;
+    case restraint::greater_equal: return high < bound;
+    case restraint::less: return low >= bound;
+    case restraint::less_equal: return low > bound;
+    default: return false;
+  }
+}
+
+// Compacts the rows that pass the comparison to the front, without branching
+// on the outcome of each one.
+template <class T, class B>
+size_t narrow (std::vector<T> const& values, u32* rows, size_t count, restraint op, B const& bound) noexcept {
+  auto keep = [&] (auto compare) noexcept {
+    size_t kept = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+      auto const row = rows[idx];
+      rows[kept] = row;
+      kept += static_cast<size_t>(compare(values[row], bound));
+    }
+    return kept;
+  };
+  switch (op) {
+    case restraint::equal_to: return keep(std::equal_to<> { });
+    case restraint::greater: return keep(std::greater<> { });
+    case restraint::greater_equal: return keep(std::greater_equal<> { });
+    case restraint::less: return keep(std::less<> { });
+    case restraint::less_equal: return keep(std::less_equal<> { });
+    default: return count;
+  }
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+struct columnar::store final {
+  struct field final {
+    std::string name;
+    data_type values;
+    std::vector<zone> zones;
+    /* Positions in value order, if sorted */
+    std::vector<u32> sorted;
+    size_t distinct { };
+  };
+
+  field const& at (i32 idx) const noexcept { return this->fields[static_cast<size_t>(idx)]; }
+
+  std::vector<field> fields;
+  size_t rows { };
+};
+
+struct columnar::scanner final : cursor {
+  explicit scanner (std::shared_ptr<store const> data) noexcept :
+    data { std::move(data) }
+  { }
+
+  void filter (sqlite::filter const& plan, std::any args) noexcept(false) override {
+    auto const& values = std::any_cast<span<value const> const&>(args);
+    this->terms.clear();
+    this->rows.clear();
+    this->current = 0;
+    planner::choice const choice { plan };
+    this->reverse = choice.order == direction::descend;
+    this->lead = choice.lead;
+    this->first = 0;
+    this->last = static_cast<i64>(this->data->rows) - 1;
+
+    if (choice.terms.size() != values.size()) { throw std::system_error(error::inappropriate_operation); }
+    for (size_t idx = 0; idx < values.size(); ++idx) {
+      auto const& item = choice.terms[idx];
+      this->constrain(item.column, item.op, values[idx].get());
+    }
+
+    if (this->lead >= 0) { this->seek(); }
+    else {
+      this->low = this->first;
+      this->high = this->last;
+    }
+    this->refill();
+  }
+
+  void column (context& ctx, i32 idx) noexcept(false) override {
+    auto const row = this->rows[this->current];
+    auto const& values = this->data->at(idx).values;
+    switch (values.index()) {
+      case 0: ctx = std::get<0>(values)[row]; break;
+      case 1: ctx = std::get<1>(values)[row]; break;
+      case 2: {
+        // The store outlives every statement that reads from it
+        auto const& text = std::get<2>(values)[row];
+        auto const size = static_cast<sqlite3_uint64>(text.size());
+        sqlite3_result_text64(ctx.get(), text.data(), size, SQLITE_STATIC, SQLITE_UTF8);
+        break;
+      }
+    }
+  }
+
+  void next () noexcept(false) override {
+    if (++this->current >= this->rows.size()) { this->refill(); }
+  }
+
+  bool ended () const noexcept override { return this->current >= this->rows.size(); }
+  i64 row () noexcept override { return this->rows[this->current]; }
+
+private:
+  void constrain (i32 column, restraint op, sqlite3_value* item) noexcept(false) {
+    if (column < 0) { return this->confine(op, item); }
+    switch (this->data->at(column).values.index()) {
+      case 0:
+        if (auto found = ::integral(op, item)) {
+          this->terms.push_back(term { column, found->first, found->second });
+        }
+        break;
+      case 1:
+        if (auto found = ::real(item)) { this->terms.push_back(term { column, op, *found }); }
+        break;
+      case 2:
+        if (sqlite3_value_type(item) == SQLITE_TEXT) {
+          auto const text = reinterpret_cast<char const*>(sqlite3_value_text(item));
+          auto const size = static_cast<size_t>(sqlite3_value_bytes(item));
+          this->terms.push_back(term { column, op, std::string { text, size } });
+        }
+        break;
+    }
+  }
+
+  /* Constraints on the rowid narrow the range of positions directly */
+  void confine (restraint op, sqlite3_value* item) noexcept {
+    auto found = ::integral(op, item);
+    if (not found) { return; }
+    auto [kind, bound] = *found;
+    switch (kind) {
+      case restraint::equal_to:
+        this->first = std::max(this->first, bound);
+        this->last = std::min(this->last, bound);
+        break;
+      case restraint::greater:
+        if (bound >= this->last) { this->last = this->first - 1; }
+        else { this->first = std::max(this->first, bound + 1); }
+        break;
+      case restraint::greater_equal: this->first = std::max(this->first, bound); break;
+      case restraint::less:
+        if (bound <= this->first) { this->last = this->first - 1; }
+        else { this->last = std::min(this->last, bound - 1); }
+        break;
+      case restraint::less_equal: this->last = std::min(this->last, bound); break;
+      default: break;
+    }
+  }
+
+  /* Narrows [low, high] to the sorted positions the lead column's terms allow */
+  void seek () noexcept {
+    auto const& field = this->data->at(this->lead);
+    auto const& sorted = field.sorted;
+    auto start = sorted.begin();
+    auto stop = sorted.end();
+    for (auto const& item : this->terms) {
+      if (item.column != this->lead) { continue; }
+      std::visit([&] (auto const& values) {
+        // Terms always hold a bound of their column's type
+        using value_type = typename std::decay_t<decltype(values)>::value_type;
+        auto const& bound = std::get<value_type>(item.bound);
+        auto below = [&values] (u32 row, value_type const& key) { return ::before { }(values[row], key); };
+        auto above = [&values] (value_type const& key, u32 row) { return ::before { }(key, values[row]); };
+        auto lower = [&] { return std::lower_bound(sorted.begin(), sorted.end(), bound, below); };
+        auto upper = [&] { return std::upper_bound(sorted.begin(), sorted.end(), bound, above); };
+        switch (item.op) {
+          case restraint::equal_to:
+            start = std::max(start, lower());
+            stop = std::min(stop, upper());
+            break;
+          case restraint::greater: start = std::max(start, upper()); break;
+          case restraint::greater_equal: start = std::max(start, lower()); break;
+          case restraint::less: stop = std::min(stop, lower()); break;
+          case restraint::less_equal: stop = std::min(stop, upper()); break;
+          default: break;
+        }
+      }, field.values);
+    }
+    this->low = start - sorted.begin();
+    this->high = std::max(start, stop) - sorted.begin() - 1;
+  }
+
+  // Fills the next batch of rows, skipping batches that end up empty, until
+  // there are rows or nothing is left.
+  void refill () noexcept(false) {
+    this->current = 0;
+    this->rows.clear();
+    while (this->rows.empty() and this->low <= this->high) {
+      if (this->lead >= 0) { this->gather(); }
+      else { this->scan(); }
+    }
+  }
+
+  /* The next block of positions, in rowid order */
+  void scan () noexcept {
+    auto const width = static_cast<i64>(block);
+    i64 start = this->low;
+    i64 stop = this->high;
+    if (this->reverse) { start = std::max(this->low, this->high / width * width); }
+    else { stop = std::min(this->high, this->low / width * width + width - 1); }
+    if (this->reverse) { this->high = start - 1; }
+    else { this->low = stop + 1; }
+
+    auto const zone = static_cast<size_t>(start) / block;
+    for (auto const& item : this->terms) {
+      if (this->excluded(item, zone)) { return; }
+    }
+    this->rows.resize(static_cast<size_t>(stop - start + 1));
+    std::iota(this->rows.begin(), this->rows.end(), static_cast<u32>(start));
+    this->narrow(false);
+  }
+
+  /* The next block of positions in the lead column's order */
+  void gather () noexcept {
+    auto const& sorted = this->data->at(this->lead).sorted;
+    auto const width = static_cast<i64>(block);
+    auto const count = std::min(width, this->high - this->low + 1);
+    auto const start = this->reverse ? this->high - count + 1 : this->low;
+    if (this->reverse) { this->high -= count; }
+    else { this->low += count; }
+    auto const begin = sorted.begin() + start;
+    this->rows.assign(begin, begin + count);
+    auto const first = this->first;
+    auto const last = this->last;
+    auto outside = [first, last] (u32 row) { return row < first or row > last; };
+    this->rows.erase(std::remove_if(this->rows.begin(), this->rows.end(), outside), this->rows.end());
+    this->narrow(true);
+  }
+
+  void narrow (bool sorted) noexcept {
+    auto count = this->rows.size();
+    for (auto const& item : this->terms) {
+      // Already applied by seek()
+      if (sorted and item.column == this->lead) { continue; }
+      if (not count) { break; }
+      auto const& values = this->data->at(item.column).values;
+      switch (values.index()) {
+        case 0: count = ::narrow(std::get<0>(values), this->rows.data(), count, item.op, std::get<i64>(item.bound)); break;
+        case 1: count = ::narrow(std::get<1>(values), this->rows.data(), count, item.op, std::get<f64>(item.bound)); break;
+        case 2: {
+          std::string_view const bound { std::get<std::string>(item.bound) };
+          count = ::narrow(std::get<2>(values), this->rows.data(), count, item.op, bound);
+          break;
+        }
+      }
+    }
+    this->rows.resize(count);
+    if (this->reverse) { std::reverse(this->rows.begin(), this->rows.end()); }
+  }
+
+  bool excluded (term const& item, size_t block) const noexcept {
+    auto const& field = this->data->at(item.column);
+    auto const [low, high] = field.zones[block];
+    switch (field.values.index()) {
+      case 0: {
+        auto const& values = std::get<0>(field.values);
+        return ::excludes(item.op, values[low], values[high], std::get<i64>(item.bound));
+      }
+      case 1: {
+        auto const& values = std::get<1>(field.values);
+        return ::excludes(item.op, values[low], values[high], std::get<f64>(item.bound));
+      }
+      case 2: {
+        auto const& values = std::get<2>(field.values);
+        std::string_view const bound { std::get<std::string>(item.bound) };
+        return ::excludes(item.op, std::string_view { values[low] }, std::string_view { values[high] }, bound);
+      }
+    }
+    return false;
+  }
+
+  std::shared_ptr<store const> data;
+  std::vector<term> terms;
+  std::vector<u32> rows;
+  size_t current { };
+  /* Remaining positions (or sorted positions, with a lead column) */
+  i64 low { };
+  i64 high { -1 };
+  /* Allowed rowids */
+  i64 first { };
+  i64 last { -1 };
+  i32 lead { -1 };
+  bool reverse { false };
+};
+
+columnar::columnar () noexcept(false) :
+  data { std::make_shared<store>() }
+{ }
+
+void columnar::add (std::string name, data_type values) noexcept(false) {
+  // Once plugged in, other instances may be reading the data
+  if (this->data.use_count() > 1) { throw std::system_error(error::inappropriate_operation); }
+  auto const count = std::visit([] (auto const& items) { return items.size(); }, values);
+  if (count > std::numeric_limits<u32>::max()) { throw std::system_error(error::argument_length_overflow); }
+  if (not this->data->fields.empty() and count != this->data->rows) {
+    throw std::system_error(error::argument_out_of_range);
+  }
+  std::vector<zone> zones;
+  zones.reserve((count + block - 1) / block);
+  std::visit([&zones, count] (auto const& items) {
+    for (size_t start = 0; start < count; start += block) {
+      auto const stop = std::min(count, start + block);
+      zone current { static_cast<u32>(start), static_cast<u32>(start) };
+      for (auto idx = start + 1; idx < stop; ++idx) {
+        if (::before { }(items[idx], items[current.low])) { current.low = static_cast<u32>(idx); }
+        if (::before { }(items[current.high], items[idx])) { current.high = static_cast<u32>(idx); }
+      }
+      zones.push_back(current);
+    }
+  }, values);
+  this->data->rows = count;
+  this->data->fields.push_back(store::field { std::move(name), std::move(values), std::move(zones), { }, { } });
+}
+
+void columnar::sort (std::string_view name) noexcept(false) {
+  if (this->data.use_count() > 1) { throw std::system_error(error::inappropriate_operation); }
+  auto& fields = this->data->fields;
+  auto found = std::find_if(fields.begin(), fields.end(), [name] (auto const& field) { return field.name == name; });
+  if (found == fields.end()) { throw std::system_error(error::argument_out_of_range); }
+  auto& field = *found;
+  field.sorted.resize(this->data->rows);
+  std::iota(field.sorted.begin(), field.sorted.end(), u32 { });
+  std::visit([&field] (auto const& items) {
+    auto less = [&items] (u32 lhs, u32 rhs) { return ::before { }(items[lhs], items[rhs]); };
+    std::stable_sort(field.sorted.begin(), field.sorted.end(), less);
+    field.distinct = field.sorted.empty() ? 0 : 1;
+    for (size_t idx = 1; idx < field.sorted.size(); ++idx) {
+      field.distinct += less(field.sorted[idx - 1], field.sorted[idx]);
+    }
+  }, field.values);
+}
+
+size_t columnar::columns () const noexcept { return this->data->fields.size(); }
+size_t columnar::size () const noexcept { return this->data->rows; }
+
+std::shared_ptr<table> columnar::clone () const noexcept(false) {
+  auto item = std::make_shared<columnar>();
+  item->data = this->data;
+  return item;
+}
+
+void columnar::connect (std::any) noexcept(false) { }
+void columnar::create (std::any) noexcept(false) { }
+
+void columnar::disconnect () noexcept(false) { }
+void columnar::destroy () noexcept(false) { }
+
+std::shared_ptr<cursor> columnar::iterator () const noexcept(false) {
+  return std::make_shared<scanner>(this->data);
+}
+
+// Every usable constraint is handed to the cursor, which narrows its scan
+// with all of them. Sorted columns can lead, in either direction.
+index::output const& columnar::access (index::input const& input) noexcept(false) {
+  auto const rows = static_cast<f64>(this->data->rows);
+  planner choice { rows };
+  choice.support(-1, { .restraints = planner::ranges, .distinct = rows, .seek = true, .reverse = true });
+  auto const& fields = this->data->fields;
+  for (size_t idx = 0; idx < fields.size(); ++idx) {
+    auto const& field = fields[idx];
+    choice.support(static_cast<i32>(idx), {
+      .restraints = planner::ranges,
+      .distinct = static_cast<f64>(field.distinct),
+      .seek = not field.sorted.empty(),
+      .reverse = true,
+      .binary = field.values.index() == 2,
+    });
+  }
+  choice.plan(input, this->plan);
+  return this->plan;
+}
+
+string columnar::schema () noexcept(false) {
+  if (this->data->fields.empty()) { throw std::system_error(error::inappropriate_operation); }
+  static constexpr char const* types[] = { "INTEGER", "REAL", "TEXT" };
+  string text { "CREATE TABLE x(" };
+  for (auto const& field : this->data->fields) {
+    text += '"';
+    for (auto c : field.name) {
+      if (c == '"') { text += '"'; }
+      text += c;
+    }
+    text += "\" ";
+    text += types[field.values.index()];
+    text += ", ";
+  }
+  text.resize(text.size() - 2);
+  text += ')';
+  return text;
+}
+
+void columnar::rename (char const*) noexcept(false) { }
+
+} /* namespace apex::sqlite */
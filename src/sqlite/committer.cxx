@@ -0,0 +1,103 @@
+#include <apex/sqlite/committer.hpp>
+#include <apex/sqlite/connection.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace apex::sqlite {
+
+committer::committer (pool& writers, budget limits) noexcept(false) :
+  writers { writers },
+  limits { limits }
+{
+  this->limits.writes = std::max<size_t>(this->limits.writes, 1);
+  this->worker = std::thread { [this] { this->run(); } };
+}
+
+committer::committer (pool& writers) noexcept(false) :
+  committer { writers, budget { } }
+{ }
+
+committer::~committer () noexcept {
+  {
+    std::lock_guard lock { this->mutex };
+    this->stopping = true;
+  }
+  this->ready.notify_one();
+  this->worker.join();
+}
+
+u64 committer::batches () const noexcept { return this->committed.load(std::memory_order_relaxed); }
+u64 committer::writes () const noexcept { return this->applied.load(std::memory_order_relaxed); }
+
+void committer::enqueue (entry item) noexcept(false) {
+  {
+    std::lock_guard lock { this->mutex };
+    this->queue.push_back(std::move(item));
+  }
+  this->ready.notify_one();
+}
+
+// Nothing here may throw past a closure, as every entry in the batch must be
+// settled exactly once.
+void committer::commit (std::vector<entry>& batch) noexcept {
+  std::vector<std::exception_ptr> errors(batch.size());
+  std::exception_ptr failure;
+  try {
+    auto conn = this->writers.writer();
+    execute(*conn, "BEGIN IMMEDIATE");
+    try {
+      for (size_t idx = 0; idx < batch.size(); ++idx) {
+        execute(*conn, "SAVEPOINT apex_committer");
+        try {
+          batch[idx].apply(*conn);
+          execute(*conn, "RELEASE apex_committer");
+        } catch (...) {
+          errors[idx] = std::current_exception();
+          execute(*conn, "ROLLBACK TO apex_committer; RELEASE apex_committer");
+        }
+      }
+      execute(*conn, "COMMIT");
+    } catch (...) {
+      // If the COMMIT itself failed, sqlite may already have rolled back
+      if (not sqlite3_get_autocommit(conn->get())) {
+        try { execute(*conn, "ROLLBACK"); }
+        catch (...) { }
+      }
+      throw;
+    }
+  } catch (...) { failure = std::current_exception(); }
+  this->committed.fetch_add(1, std::memory_order_relaxed);
+  this->applied.fetch_add(batch.size(), std::memory_order_relaxed);
+  for (size_t idx = 0; idx < batch.size(); ++idx) {
+    batch[idx].settle(failure ? failure : errors[idx]);
+  }
+  batch.clear();
+}
+
+void committer::run () noexcept {
+  std::vector<entry> batch;
+  batch.reserve(this->limits.writes);
+  std::unique_lock lock { this->mutex };
+  while (true) {
+    this->ready.wait(lock, [this] { return this->stopping or not this->queue.empty(); });
+    if (this->queue.empty()) { return; }
+    if (this->limits.delay.count() > 0) {
+      auto const deadline = std::chrono::steady_clock::now() + this->limits.delay;
+      this->ready.wait_until(lock, deadline, [this] {
+        return this->stopping or this->queue.size() >= this->limits.writes;
+      });
+    }
+    auto const count = std::min(this->queue.size(), this->limits.writes);
+    auto const start = this->queue.begin();
+    auto const stop = std::next(start, static_cast<ptrdiff_t>(count));
+    std::move(start, stop, std::back_inserter(batch));
+    this->queue.erase(start, stop);
+    lock.unlock();
+    this->commit(batch);
+    lock.lock();
+  }
+}
+
+} /* namespace apex::sqlite */
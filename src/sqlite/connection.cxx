@@ -1,4 +1,5 @@
 #include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/deadline.hpp>
 #include <apex/sqlite/memory.hpp>
 #include <apex/sqlite/table.hpp>
 #include <apex/sqlite/error.hpp>
@@ -12,12 +13,47 @@ void default_delete<sqlite3>::operator () (sqlite3* ptr) noexcept {
   sqlite3_close_v2(ptr);
 }
 
-//connection::connection (::std::filesystem::path const& path) noexcept(false) :
-//  resource_type { }
-//{
-//  sqlite3_open_v2(path.c_str(), out_ptr(static_cast<resource_type&>(*this)), SQLITE_OPEN_READONLY, nullptr);
-//  throw ::std::runtime_error("Not yet implemented");
-//}
+connection::connection (::std::filesystem::path const& path, access mode, std::string_view vfs) noexcept(false) :
+  resource_type { },
+  current { std::make_unique<deadline::scope const*>() }
+{
+  std::string const name { vfs };
+  auto flags = SQLITE_OPEN_NOMUTEX;
+  switch (mode) {
+    case access::read_only: flags |= SQLITE_OPEN_READONLY; break;
+    case access::read_write: flags |= SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE; break;
+  }
+  auto const module = name.empty() ? nullptr : name.c_str();
+  auto result = sqlite3_open_v2(path.c_str(), out_ptr(this->storage), flags, module);
+  if (result) { throw std::system_error(error(result)); }
+  sqlite3_progress_handler(this->get(), deadline::interval, &deadline::progress, this->current.get());
+}
+
+connection::connection (::std::filesystem::path const& path, access mode) noexcept(false) :
+  connection { path, mode, std::string_view { } }
+{ }
+
+connection::connection (::std::filesystem::path const& path) noexcept(false) :
+  connection { path, access::read_write }
+{ }
+
+bool connection::autocommit () const noexcept {
+  return sqlite3_get_autocommit(this->get());
+}
+
+cache::lease connection::prepare (std::string_view sql) noexcept(false) {
+  return this->prepared.acquire(*this, sql);
+}
+
+cache& connection::statements () noexcept { return this->prepared; }
+
+void execute (connection& conn, std::string_view sql) noexcept(false) {
+  while (not sql.empty()) {
+    auto stmt = conn.prepare(sql);
+    stmt->execute();
+    sql = stmt.tail();
+  }
+}
 
 void plugin (connection& conn, std::string_view name, std::shared_ptr<table> item) noexcept(false) {
   auto destructor = [] (void* ptr) noexcept {
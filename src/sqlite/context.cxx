@@ -0,0 +1,138 @@
+#include <apex/sqlite/context.hpp>
+#include <apex/sqlite/memoize.hpp>
+#include <apex/sqlite/value.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <limits>
+#include <new>
+
+static_assert(sizeof(apex::sqlite::value) == sizeof(sqlite3_value*));
+
+namespace {
+
+// Copying a result can run out of memory, which only keeps it from being
+// cached.
+template <class F>
+void capture (apex::sqlite::recording* recorder, F&& copy) noexcept {
+  if (not recorder) { return; }
+  try { copy(recorder->result); }
+  catch (...) { recorder->failed = true; }
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+context::context (pointer ptr, ptrdiff_t count, sqlite3_value** values) noexcept(false) :
+  handle { ptr },
+  values { values },
+  count { count }
+{ }
+
+context::context (pointer ptr) noexcept(false) :
+  context { ptr, 0, nullptr }
+{ }
+
+void context::operator = (std::error_code const& code) const noexcept {
+  if (this->recorder) { this->recorder->failed = true; }
+  if (code.category() == category()) {
+    sqlite3_result_error_code(this->get(), code.value());
+    return;
+  }
+  sqlite3_result_error(this->get(), code.message().c_str(), -1);
+}
+
+void context::operator = (std::exception_ptr const& error) const noexcept {
+  if (this->recorder) { this->recorder->failed = true; }
+  try { std::rethrow_exception(error); }
+  catch (std::system_error const& e) {
+    sqlite3_result_error(this->get(), e.what(), -1);
+    if (e.code().category() == category()) { sqlite3_result_error_code(this->get(), e.code().value()); }
+  }
+  catch (std::bad_alloc const&) { sqlite3_result_error_nomem(this->get()); }
+  catch (std::exception const& e) { sqlite3_result_error(this->get(), e.what(), -1); }
+  catch (...) { sqlite3_result_error(this->get(), "unknown error", -1); }
+}
+
+void context::operator = (string_view text) const noexcept {
+  ::capture(this->recorder, [text] (auto& result) { result.template emplace<std::string>(text); });
+  auto const size = static_cast<sqlite3_uint64>(text.size());
+  sqlite3_result_text64(this->get(), text.data(), size, SQLITE_TRANSIENT, SQLITE_UTF8);
+}
+
+void context::operator = (value const& item) const noexcept {
+  ::capture(this->recorder, [&item] (auto& result) {
+    switch (sqlite3_value_type(item.get())) {
+      case SQLITE_INTEGER: result = static_cast<i64>(item); break;
+      case SQLITE_FLOAT: result = static_cast<f64>(item); break;
+      case SQLITE_TEXT: result.template emplace<std::string>(static_cast<std::string_view>(item)); break;
+      case SQLITE_BLOB: {
+        auto const blob = static_cast<span<byte const>>(item);
+        result.template emplace<std::vector<byte>>(blob.begin(), blob.end());
+        break;
+      }
+      default: result = std::monostate { }; break;
+    }
+  });
+  sqlite3_result_value(this->get(), item.get());
+}
+
+void context::operator = (span<byte> blob) const noexcept {
+  ::capture(this->recorder, [blob] (auto& result) {
+    result.template emplace<std::vector<byte>>(blob.begin(), blob.end());
+  });
+  auto const size = static_cast<sqlite3_uint64>(blob.size());
+  sqlite3_result_blob64(this->get(), blob.data(), size, SQLITE_TRANSIENT);
+}
+
+void context::operator = (f64 number) const noexcept {
+  if (this->recorder) { this->recorder->result = number; }
+  sqlite3_result_double(this->get(), number);
+}
+
+/* sqlite has no unsigned integers, so those too large for an i64 become reals */
+void context::operator = (u64 number) const noexcept {
+  if (number > static_cast<u64>(std::numeric_limits<i64>::max())) {
+    *this = static_cast<f64>(number);
+  } else { *this = static_cast<i64>(number); }
+}
+
+void context::operator = (u32 number) const noexcept { *this = static_cast<i64>(number); }
+void context::operator = (i32 number) const noexcept { *this = static_cast<i64>(number); }
+
+void context::operator = (i64 number) const noexcept {
+  if (this->recorder) { this->recorder->result = number; }
+  sqlite3_result_int64(this->get(), number);
+}
+
+value const& context::operator [] (ptrdiff_t idx) const noexcept {
+  return reinterpret_cast<value const*>(this->values)[idx];
+}
+
+void* context::auxiliary (ptrdiff_t idx) const noexcept {
+  return sqlite3_get_auxdata(this->get(), static_cast<int>(idx));
+}
+
+void context::auxiliary (ptrdiff_t idx, void* ptr, void (*destructor)(void*)) const noexcept {
+  sqlite3_set_auxdata(this->get(), static_cast<int>(idx), ptr, destructor);
+}
+
+void context::record (recording* recorder) noexcept { this->recorder = recorder; }
+
+context::pointer context::get () const noexcept { return this->handle.get(); }
+ptrdiff_t context::size () const noexcept { return this->count; }
+bool context::empty () const noexcept { return not this->count; }
+void* context::user () const noexcept { return sqlite3_user_data(this->get()); }
+
+} /* namespace apex::sqlite */
+
+/* Memory that lives for as long as the aggregate does, and is zeroed on first use */
+void* operator new (std::size_t size, apex::sqlite::context& ctx) {
+  auto ptr = sqlite3_aggregate_context(ctx.get(), static_cast<int>(size));
+  if (not ptr) { throw std::bad_alloc { }; }
+  return ptr;
+}
+
+/* sqlite releases the memory itself */
+void operator delete (void*, apex::sqlite::context&) { }
@@ -0,0 +1,61 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/deadline.hpp>
+
+#include <utility>
+
+namespace apex::sqlite {
+
+deadline::deadline (clock::time_point until, std::stop_token token) noexcept :
+  until { until },
+  token { std::move(token) }
+{ }
+
+deadline::deadline (clock::duration budget, std::stop_token token) noexcept :
+  deadline { clock::now() + budget, std::move(token) }
+{ }
+
+deadline::deadline (clock::time_point until) noexcept :
+  deadline { until, std::stop_token { } }
+{ }
+
+deadline::deadline (clock::duration budget) noexcept :
+  deadline { clock::now() + budget, std::stop_token { } }
+{ }
+
+deadline::deadline (std::stop_token token) noexcept :
+  deadline { clock::time_point::max(), std::move(token) }
+{ }
+
+bool deadline::expired () const noexcept {
+  if (this->until != clock::time_point::max() and clock::now() >= this->until) { return true; }
+  return this->token.stop_requested();
+}
+
+int deadline::progress (void* ptr) noexcept {
+  auto const slot = static_cast<scope const* const*>(ptr);
+  for (auto item = slot ? *slot : nullptr; item; item = item->previous) {
+    if (item->limit.expired()) { return 1; }
+  }
+  return 0;
+}
+
+deadline::scope::scope (scope const** slot, deadline limit) noexcept :
+  limit { std::move(limit) },
+  previous { slot ? *slot : nullptr },
+  slot { slot }
+{ if (slot) { *slot = this; } }
+
+deadline::scope::scope (connection& conn, deadline limit) noexcept :
+  scope { conn.current.get(), std::move(limit) }
+{ }
+
+deadline::scope::scope (statement const& stmt, deadline limit) noexcept :
+  scope { stmt.bounds, std::move(limit) }
+{ }
+
+deadline::scope::~scope () noexcept {
+  if (this->slot) { *this->slot = this->previous; }
+}
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,550 @@
+#include <apex/sqlite/ephemeral.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <vector>
+#include <array>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+using apex::byte;
+using apex::i64;
+using apex::u8;
+
+size_t round (size_t value, size_t granule) noexcept {
+  return (value + granule - 1) / granule * granule;
+}
+
+size_t page () noexcept {
+  static size_t const result = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  return result;
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+/** @brief The contents, and lock state, of a single file.
+ *
+ * The contents are read and written without holding the mutex. sqlite's own
+ * locking already keeps writers away from the ranges other connections are
+ * reading, and the address of the contents never changes.
+ */
+struct ephemeral::node final {
+  node (size_t capacity, [[maybe_unused]] bool memfd) noexcept(false) :
+    capacity { capacity }
+  {
+#if defined(MFD_CLOEXEC)
+    if (memfd) { this->fd = ::memfd_create("apex-sqlite", MFD_CLOEXEC); }
+    if (memfd and this->fd < 0) { throw std::system_error(error::cannot_open_resource); }
+#endif /* defined(MFD_CLOEXEC) */
+    auto const flags = this->fd < 0
+      ? MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+      : MAP_SHARED | MAP_NORESERVE;
+    auto const data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, flags, this->fd, 0);
+    if (data == MAP_FAILED) {
+      if (this->fd >= 0) { ::close(this->fd); }
+      throw std::system_error(error::not_enough_memory);
+    }
+    this->data = static_cast<byte*>(data);
+  }
+
+  node (node const&) = delete;
+  ~node () noexcept {
+    ::munmap(this->data, this->capacity);
+    if (this->fd >= 0) { ::close(this->fd); }
+  }
+
+  i64 size () const noexcept { return this->length.load(std::memory_order_acquire); }
+
+  /* Makes sure [0, end) can be written to. Called with the mutex held */
+  bool reserve (size_t end) noexcept {
+    if (end > this->capacity) { return false; }
+    if (this->fd < 0 or end <= this->committed) { return true; }
+    auto const target = std::min(::round(end, size_t { 1 } << 20), this->capacity);
+    if (::ftruncate(this->fd, static_cast<off_t>(target))) { return false; }
+    this->committed = target;
+    return true;
+  }
+
+  // Gives back whatever lies past `end`, so that the file reads as zeroes
+  // there if it ever grows again. Called with the mutex held.
+  void release (size_t end) noexcept {
+    auto const previous = static_cast<size_t>(this->size());
+    if (end >= previous) { return; }
+    this->length.store(static_cast<i64>(end), std::memory_order_release);
+    auto const boundary = ::round(end, ::page());
+    std::memset(this->data + end, 0, std::min(boundary, previous) - end);
+    if (boundary >= previous) { return; }
+    if (this->fd >= 0) {
+      ::ftruncate(this->fd, static_cast<off_t>(boundary));
+      this->committed = boundary;
+      return;
+    }
+    ::madvise(this->data + boundary, ::round(previous, ::page()) - boundary, MADV_DONTNEED);
+  }
+
+  size_t footprint () const noexcept {
+    std::lock_guard lock { this->mutex };
+    return static_cast<size_t>(this->size()) + this->regions.size() * this->region;
+  }
+
+  byte* data { };
+  size_t capacity;
+  size_t committed { };
+  std::atomic<i64> length { };
+  int fd { -1 };
+
+  mutable std::mutex mutex;
+
+  /* File locks, as held by every open handle */
+  int readers { };
+  bool reserved { false };
+  bool pending { false };
+  bool exclusive { false };
+
+  /* The WAL index, and its locks */
+  std::vector<std::unique_ptr<byte[]>> regions;
+  size_t region { };
+  int mappings { };
+  std::array<int, SQLITE_SHM_NLOCK> shared { };
+  u8 owned { };
+};
+
+struct ephemeral::file final : sqlite3_file {
+  static int open (sqlite3_vfs*, char const*, sqlite3_file*, int, int*) noexcept;
+  static int remove (sqlite3_vfs*, char const*, int) noexcept;
+  static int access (sqlite3_vfs*, char const*, int, int*) noexcept;
+  static int resolve (sqlite3_vfs*, char const*, int, char*) noexcept;
+
+  static void* dlopen (sqlite3_vfs*, char const*) noexcept;
+  static void dlerror (sqlite3_vfs*, int, char*) noexcept;
+  static void (*dlsym (sqlite3_vfs*, void*, char const*) noexcept)();
+  static void dlclose (sqlite3_vfs*, void*) noexcept;
+  static int randomness (sqlite3_vfs*, int, char*) noexcept;
+  static int sleep (sqlite3_vfs*, int) noexcept;
+  static int now (sqlite3_vfs*, double*) noexcept;
+  static int failure (sqlite3_vfs*, int, char*) noexcept;
+  static int now64 (sqlite3_vfs*, sqlite3_int64*) noexcept;
+
+  static int close (sqlite3_file*) noexcept;
+  static int read (sqlite3_file*, void*, int, sqlite3_int64) noexcept;
+  static int write (sqlite3_file*, void const*, int, sqlite3_int64) noexcept;
+  static int truncate (sqlite3_file*, sqlite3_int64) noexcept;
+  static int sync (sqlite3_file*, int) noexcept;
+  static int size (sqlite3_file*, sqlite3_int64*) noexcept;
+  static int lock (sqlite3_file*, int) noexcept;
+  static int unlock (sqlite3_file*, int) noexcept;
+  static int reserved (sqlite3_file*, int*) noexcept;
+  static int control (sqlite3_file*, int, void*) noexcept;
+  static int sector (sqlite3_file*) noexcept;
+  static int device (sqlite3_file*) noexcept;
+  static int shm_map (sqlite3_file*, int, int, int, void volatile**) noexcept;
+  static int shm_lock (sqlite3_file*, int, int, int) noexcept;
+  static void shm_barrier (sqlite3_file*) noexcept;
+  static int shm_unmap (sqlite3_file*, int) noexcept;
+  static int fetch (sqlite3_file*, sqlite3_int64, int, void**) noexcept;
+  static int unfetch (sqlite3_file*, sqlite3_int64, void*) noexcept;
+
+  static sqlite3_io_methods const methods;
+
+  static file& self (sqlite3_file* ptr) noexcept { return *static_cast<file*>(ptr); }
+  static ephemeral& owner (sqlite3_vfs* ptr) noexcept { return *static_cast<ephemeral*>(ptr->pAppData); }
+
+  std::shared_ptr<node> item;
+  ephemeral* parent { };
+  std::string path;
+  int level { SQLITE_LOCK_NONE };
+  bool reserving { false };
+  bool erase { false };
+  bool mapped { false };
+  /* WAL index locks held by this handle */
+  u8 shared { };
+  u8 exclusive { };
+};
+
+sqlite3_io_methods const ephemeral::file::methods {
+  3,
+  ephemeral::file::close,
+  ephemeral::file::read,
+  ephemeral::file::write,
+  ephemeral::file::truncate,
+  ephemeral::file::sync,
+  ephemeral::file::size,
+  ephemeral::file::lock,
+  ephemeral::file::unlock,
+  ephemeral::file::reserved,
+  ephemeral::file::control,
+  ephemeral::file::sector,
+  ephemeral::file::device,
+  ephemeral::file::shm_map,
+  ephemeral::file::shm_lock,
+  ephemeral::file::shm_barrier,
+  ephemeral::file::shm_unmap,
+  ephemeral::file::fetch,
+  ephemeral::file::unfetch,
+};
+
+int ephemeral::file::open (sqlite3_vfs* handle, char const* name, sqlite3_file* out, int flags, int* outflags) noexcept {
+  auto& vfs = owner(handle);
+  out->pMethods = nullptr;
+  try {
+    std::shared_ptr<node> item;
+    if (name) {
+      std::lock_guard lock { vfs.mutex };
+      auto found = vfs.files.find(std::string_view { name });
+      auto const exists = found != vfs.files.end();
+      if (exists and (flags & SQLITE_OPEN_EXCLUSIVE)) { return SQLITE_CANTOPEN; }
+      if (not exists and not (flags & SQLITE_OPEN_CREATE)) { return SQLITE_CANTOPEN; }
+      if (not exists) {
+        found = vfs.files.emplace(name, std::make_shared<node>(vfs.capacity, vfs.memfd)).first;
+      }
+      item = found->second;
+    } else { item = std::make_shared<node>(vfs.capacity, vfs.memfd); }
+    auto ptr = ::new (static_cast<void*>(out)) file { };
+    ptr->item = std::move(item);
+    ptr->parent = std::addressof(vfs);
+    ptr->erase = name and (flags & SQLITE_OPEN_DELETEONCLOSE);
+    if (ptr->erase) { ptr->path = name; }
+  } catch (std::bad_alloc const&) {
+    return SQLITE_NOMEM;
+  } catch (...) {
+    return SQLITE_CANTOPEN;
+  }
+  if (outflags) { *outflags = flags; }
+  out->pMethods = std::addressof(methods);
+  return SQLITE_OK;
+}
+
+int ephemeral::file::remove (sqlite3_vfs* handle, char const* name, int) noexcept {
+  return owner(handle).remove(name) ? SQLITE_OK : SQLITE_IOERR_DELETE_NOENT;
+}
+
+int ephemeral::file::access (sqlite3_vfs* handle, char const* name, int flags, int* out) noexcept {
+  auto& vfs = owner(handle);
+  std::lock_guard lock { vfs.mutex };
+  auto found = vfs.files.find(std::string_view { name });
+  *out = found != vfs.files.end();
+  // Like the unix VFS, an empty file does not count as existing
+  if (*out and flags == SQLITE_ACCESS_EXISTS) { *out = found->second->size() > 0; }
+  return SQLITE_OK;
+}
+
+int ephemeral::file::resolve (sqlite3_vfs*, char const* name, int size, char* out) noexcept {
+  if (static_cast<int>(std::strlen(name)) >= size) { return SQLITE_CANTOPEN; }
+  sqlite3_snprintf(size, out, "%s", name);
+  return SQLITE_OK;
+}
+
+void* ephemeral::file::dlopen (sqlite3_vfs* handle, char const* path) noexcept {
+  auto base = owner(handle).base;
+  return base->xDlOpen(base, path);
+}
+
+void ephemeral::file::dlerror (sqlite3_vfs* handle, int size, char* out) noexcept {
+  auto base = owner(handle).base;
+  base->xDlError(base, size, out);
+}
+
+void (*ephemeral::file::dlsym (sqlite3_vfs* handle, void* library, char const* symbol) noexcept)() {
+  auto base = owner(handle).base;
+  return base->xDlSym(base, library, symbol);
+}
+
+void ephemeral::file::dlclose (sqlite3_vfs* handle, void* library) noexcept {
+  auto base = owner(handle).base;
+  base->xDlClose(base, library);
+}
+
+int ephemeral::file::randomness (sqlite3_vfs* handle, int size, char* out) noexcept {
+  auto base = owner(handle).base;
+  return base->xRandomness(base, size, out);
+}
+
+int ephemeral::file::sleep (sqlite3_vfs* handle, int microseconds) noexcept {
+  auto base = owner(handle).base;
+  return base->xSleep(base, microseconds);
+}
+
+int ephemeral::file::now (sqlite3_vfs* handle, double* out) noexcept {
+  auto base = owner(handle).base;
+  return base->xCurrentTime(base, out);
+}
+
+int ephemeral::file::failure (sqlite3_vfs* handle, int size, char* out) noexcept {
+  auto base = owner(handle).base;
+  return base->xGetLastError ? base->xGetLastError(base, size, out) : 0;
+}
+
+int ephemeral::file::now64 (sqlite3_vfs* handle, sqlite3_int64* out) noexcept {
+  auto base = owner(handle).base;
+  if (base->iVersion >= 2 and base->xCurrentTimeInt64) { return base->xCurrentTimeInt64(base, out); }
+  double days = 0;
+  auto const result = base->xCurrentTime(base, &days);
+  *out = static_cast<sqlite3_int64>(days * 86'400'000.0);
+  return result;
+}
+
+int ephemeral::file::close (sqlite3_file* ptr) noexcept {
+  auto& item = self(ptr);
+  shm_unmap(ptr, 0);
+  unlock(ptr, SQLITE_LOCK_NONE);
+  if (item.erase) {
+    std::lock_guard lock { item.parent->mutex };
+    auto found = item.parent->files.find(item.path);
+    if (found != item.parent->files.end() and found->second == item.item) { item.parent->files.erase(found); }
+  }
+  std::destroy_at(std::addressof(item));
+  return SQLITE_OK;
+}
+
+int ephemeral::file::read (sqlite3_file* ptr, void* out, int amount, sqlite3_int64 offset) noexcept {
+  auto const& item = *self(ptr).item;
+  auto const length = item.size();
+  auto const available = std::clamp<i64>(length - offset, 0, amount);
+  if (available) { std::memcpy(out, item.data + offset, static_cast<size_t>(available)); }
+  if (available == amount) { return SQLITE_OK; }
+  std::memset(static_cast<byte*>(out) + available, 0, static_cast<size_t>(amount - available));
+  return SQLITE_IOERR_SHORT_READ;
+}
+
+int ephemeral::file::write (sqlite3_file* ptr, void const* data, int amount, sqlite3_int64 offset) noexcept {
+  auto& item = *self(ptr).item;
+  auto const end = static_cast<size_t>(offset) + static_cast<size_t>(amount);
+  if (static_cast<i64>(end) > item.size()) {
+    std::lock_guard lock { item.mutex };
+    if (not item.reserve(end)) { return SQLITE_FULL; }
+    std::memcpy(item.data + offset, data, static_cast<size_t>(amount));
+    auto const length = std::max(item.size(), static_cast<i64>(end));
+    item.length.store(length, std::memory_order_release);
+    return SQLITE_OK;
+  }
+  std::memcpy(item.data + offset, data, static_cast<size_t>(amount));
+  return SQLITE_OK;
+}
+
+int ephemeral::file::truncate (sqlite3_file* ptr, sqlite3_int64 size) noexcept {
+  auto& item = *self(ptr).item;
+  std::lock_guard lock { item.mutex };
+  item.release(static_cast<size_t>(size));
+  return SQLITE_OK;
+}
+
+int ephemeral::file::sync (sqlite3_file*, int) noexcept { return SQLITE_OK; }
+
+int ephemeral::file::size (sqlite3_file* ptr, sqlite3_int64* out) noexcept {
+  *out = self(ptr).item->size();
+  return SQLITE_OK;
+}
+
+// Mirrors the unix VFS: a PENDING lock keeps new readers out while a writer
+// waits for the existing ones to finish, and is held until EXCLUSIVE is.
+int ephemeral::file::lock (sqlite3_file* ptr, int level) noexcept {
+  auto& handle = self(ptr);
+  auto& item = *handle.item;
+  if (handle.level >= level) { return SQLITE_OK; }
+  std::lock_guard lock { item.mutex };
+  switch (level) {
+    case SQLITE_LOCK_SHARED:
+      if (item.pending or item.exclusive) { return SQLITE_BUSY; }
+      ++item.readers;
+      break;
+    case SQLITE_LOCK_RESERVED:
+      if (item.reserved) { return SQLITE_BUSY; }
+      item.reserved = handle.reserving = true;
+      break;
+    case SQLITE_LOCK_EXCLUSIVE:
+      if (handle.level < SQLITE_LOCK_PENDING) {
+        if (item.pending) { return SQLITE_BUSY; }
+        item.pending = true;
+        handle.level = SQLITE_LOCK_PENDING;
+      }
+      if (item.readers > 1) { return SQLITE_BUSY; }
+      item.exclusive = true;
+      break;
+    default: return SQLITE_MISUSE;
+  }
+  handle.level = level;
+  return SQLITE_OK;
+}
+
+int ephemeral::file::unlock (sqlite3_file* ptr, int level) noexcept {
+  auto& handle = self(ptr);
+  auto& item = *handle.item;
+  if (handle.level <= level) { return SQLITE_OK; }
+  std::lock_guard lock { item.mutex };
+  if (handle.level >= SQLITE_LOCK_PENDING) {
+    item.pending = false;
+    item.exclusive = false;
+  }
+  if (handle.reserving) { item.reserved = handle.reserving = false; }
+  if (level == SQLITE_LOCK_NONE) { --item.readers; }
+  handle.level = level;
+  return SQLITE_OK;
+}
+
+int ephemeral::file::reserved (sqlite3_file* ptr, int* out) noexcept {
+  auto const& item = *self(ptr).item;
+  std::lock_guard lock { item.mutex };
+  *out = item.reserved or item.pending or item.exclusive;
+  return SQLITE_OK;
+}
+
+int ephemeral::file::control (sqlite3_file* ptr, int op, void* arg) noexcept {
+  if (op != SQLITE_FCNTL_VFSNAME) { return SQLITE_NOTFOUND; }
+  *static_cast<char**>(arg) = sqlite3_mprintf("%s", self(ptr).parent->name());
+  return SQLITE_OK;
+}
+
+int ephemeral::file::sector (sqlite3_file*) noexcept { return 4096; }
+
+int ephemeral::file::device (sqlite3_file*) noexcept {
+  return SQLITE_IOCAP_ATOMIC
+    | SQLITE_IOCAP_SAFE_APPEND
+    | SQLITE_IOCAP_SEQUENTIAL
+    | SQLITE_IOCAP_POWERSAFE_OVERWRITE;
+}
+
+int ephemeral::file::shm_map (sqlite3_file* ptr, int page, int size, int extend, void volatile** out) noexcept {
+  auto& handle = self(ptr);
+  auto& item = *handle.item;
+  std::lock_guard lock { item.mutex };
+  if (item.region and item.region != static_cast<size_t>(size)) { return SQLITE_IOERR_SHMSIZE; }
+  item.region = static_cast<size_t>(size);
+  if (not handle.mapped) {
+    handle.mapped = true;
+    ++item.mappings;
+  }
+  *out = nullptr;
+  auto const index = static_cast<size_t>(page);
+  if (index >= item.regions.size() and not extend) { return SQLITE_OK; }
+  try {
+    while (item.regions.size() <= index) { item.regions.push_back(std::make_unique<byte[]>(item.region)); }
+  } catch (...) { return SQLITE_NOMEM; }
+  *out = item.regions[index].get();
+  return SQLITE_OK;
+}
+
+int ephemeral::file::shm_lock (sqlite3_file* ptr, int offset, int count, int flags) noexcept {
+  auto& handle = self(ptr);
+  auto& item = *handle.item;
+  auto const mask = static_cast<u8>(((1u << count) - 1) << offset);
+  std::lock_guard lock { item.mutex };
+  if (flags & SQLITE_SHM_UNLOCK) {
+    for (int idx = offset; idx < offset + count; ++idx) {
+      if (handle.shared & (1u << idx)) { --item.shared[idx]; }
+    }
+    item.owned &= static_cast<u8>(~(handle.exclusive & mask));
+    handle.shared &= static_cast<u8>(~mask);
+    handle.exclusive &= static_cast<u8>(~mask);
+    return SQLITE_OK;
+  }
+  if (flags & SQLITE_SHM_SHARED) {
+    if (handle.shared & mask) { return SQLITE_OK; }
+    if (item.owned & mask) { return SQLITE_BUSY; }
+    for (int idx = offset; idx < offset + count; ++idx) { ++item.shared[idx]; }
+    handle.shared |= mask;
+    return SQLITE_OK;
+  }
+  if (item.owned & mask & ~handle.exclusive) { return SQLITE_BUSY; }
+  for (int idx = offset; idx < offset + count; ++idx) {
+    auto const mine = (handle.shared >> idx) & 1;
+    if (item.shared[idx] > mine) { return SQLITE_BUSY; }
+  }
+  item.owned |= mask;
+  handle.exclusive |= mask;
+  return SQLITE_OK;
+}
+
+void ephemeral::file::shm_barrier (sqlite3_file*) noexcept {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// The WAL index is rebuilt from the WAL whenever it is missing, so it can be
+// freed as soon as nothing has it mapped.
+int ephemeral::file::shm_unmap (sqlite3_file* ptr, int) noexcept {
+  auto& handle = self(ptr);
+  auto& item = *handle.item;
+  if (not handle.mapped) { return SQLITE_OK; }
+  shm_lock(ptr, 0, SQLITE_SHM_NLOCK, SQLITE_SHM_UNLOCK | SQLITE_SHM_SHARED);
+  std::lock_guard lock { item.mutex };
+  handle.mapped = false;
+  if (--item.mappings == 0) {
+    item.regions.clear();
+    item.region = 0;
+  }
+  return SQLITE_OK;
+}
+
+int ephemeral::file::fetch (sqlite3_file* ptr, sqlite3_int64 offset, int amount, void** out) noexcept {
+  auto const& item = *self(ptr).item;
+  auto const covered = offset + amount <= item.size();
+  *out = covered ? item.data + offset : nullptr;
+  return SQLITE_OK;
+}
+
+int ephemeral::file::unfetch (sqlite3_file*, sqlite3_int64, void*) noexcept { return SQLITE_OK; }
+
+ephemeral::ephemeral (std::string name, options opts) noexcept(false) :
+  handle { std::make_unique<sqlite3_vfs>() },
+  base { sqlite3_vfs_find(nullptr) },
+  label { std::move(name) },
+  capacity { ::round(std::max<size_t>(opts.capacity, 1), ::page()) },
+  memfd { opts.memfd }
+{
+  if (not this->base) { throw std::system_error(error::generic); }
+  auto& item = *this->handle;
+  item.iVersion = 2;
+  item.szOsFile = static_cast<int>(sizeof(file));
+  item.mxPathname = this->base->mxPathname;
+  item.zName = this->label.c_str();
+  item.pAppData = this;
+  item.xOpen = file::open;
+  item.xDelete = file::remove;
+  item.xAccess = file::access;
+  item.xFullPathname = file::resolve;
+  item.xDlOpen = file::dlopen;
+  item.xDlError = file::dlerror;
+  item.xDlSym = file::dlsym;
+  item.xDlClose = file::dlclose;
+  item.xRandomness = file::randomness;
+  item.xSleep = file::sleep;
+  item.xCurrentTime = file::now;
+  item.xGetLastError = file::failure;
+  item.xCurrentTimeInt64 = file::now64;
+  if (auto result = sqlite3_vfs_register(std::addressof(item), opts.preferred)) {
+    throw std::system_error(error(result));
+  }
+}
+
+ephemeral::ephemeral (std::string name) noexcept(false) :
+  ephemeral { std::move(name), options { } }
+{ }
+
+ephemeral::~ephemeral () noexcept { sqlite3_vfs_unregister(this->handle.get()); }
+
+char const* ephemeral::name () const noexcept { return this->label.c_str(); }
+
+bool ephemeral::remove (std::string_view path) noexcept {
+  std::lock_guard lock { this->mutex };
+  auto found = this->files.find(path);
+  if (found == this->files.end()) { return false; }
+  this->files.erase(found);
+  return true;
+}
+
+size_t ephemeral::size () const noexcept {
+  std::lock_guard lock { this->mutex };
+  size_t total = 0;
+  for (auto const& [path, item] : this->files) { total += item->footprint(); }
+  return total;
+}
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,22 @@
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <string>
+
+namespace {
+
+struct sqlite_category final : std::error_category {
+  char const* name () const noexcept override { return "apex::sqlite"; }
+  std::string message (int code) const override { return sqlite3_errstr(code); }
+};
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+std::error_category const& category () noexcept {
+  static sqlite_category instance;
+  return instance;
+}
+
+} /* namespace apex::sqlite */
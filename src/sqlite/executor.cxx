@@ -0,0 +1,55 @@
+#include <apex/sqlite/executor.hpp>
+
+namespace apex::sqlite {
+
+void executor::awaitable::await_suspend (coroutine_handle<> handle) const noexcept(false) {
+  if (this->dispatching and this->owner.dispatcher) { return this->owner.dispatcher(handle); }
+  if (this->dispatching) { return handle.resume(); }
+  this->owner.post([handle] { handle.resume(); });
+}
+
+executor::executor (dispatch_type dispatcher) noexcept(false) :
+  dispatcher { std::move(dispatcher) }
+{ this->worker = std::thread { [this] { this->run(); } }; }
+
+executor::executor () noexcept(false) :
+  executor { nullptr }
+{ }
+
+executor::~executor () noexcept {
+  {
+    std::lock_guard lock { this->mutex };
+    this->stopping = true;
+  }
+  this->ready.notify_one();
+  this->worker.join();
+}
+
+void executor::post (work_type work) noexcept(false) {
+  {
+    std::lock_guard lock { this->mutex };
+    this->queue.push_back(std::move(work));
+  }
+  this->ready.notify_one();
+}
+
+bool executor::running_in_this_thread () const noexcept {
+  return this->worker.get_id() == std::this_thread::get_id();
+}
+
+void executor::run () noexcept {
+  std::unique_lock lock { this->mutex };
+  while (true) {
+    this->ready.wait(lock, [this] { return this->stopping or not this->queue.empty(); });
+    if (this->queue.empty()) { return; }
+    auto work = std::move(this->queue.front());
+    this->queue.pop_front();
+    lock.unlock();
+    work();
+    // Destroyed here, so anything it owns is released on this thread
+    work = nullptr;
+    lock.lock();
+  }
+}
+
+} /* namespace apex::sqlite */
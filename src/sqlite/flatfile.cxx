@@ -0,0 +1,456 @@
+#include <apex/sqlite/flatfile.hpp>
+#include <apex/sqlite/planner.hpp>
+#include <apex/sqlite/context.hpp>
+#include <apex/sqlite/value.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/core/span.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <mutex>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+  #include <immintrin.h>
+#endif /* defined(__x86_64__) */
+
+namespace {
+
+using apex::sqlite::restraint;
+using apex::sqlite::affinity;
+using apex::sqlite::flatfile;
+using apex::sqlite::error;
+using apex::i64;
+using apex::u32;
+
+/* Every this many lines, the offset of a line is recorded */
+constexpr size_t stride = 64;
+constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+#if defined(__x86_64__)
+[[gnu::target("avx2")]]
+char const* search (char const* first, char const* last) noexcept {
+  auto const needle = _mm256_set1_epi8('\n');
+  for (; last - first >= 32; first += 32) {
+    auto const chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+    auto const mask = static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    if (mask) { return first + __builtin_ctz(mask); }
+  }
+  for (; first != last; ++first) {
+    if (*first == '\n') { return first; }
+  }
+  return last;
+}
+#endif /* defined(__x86_64__) */
+
+/* Returns last if there is no newline */
+char const* newline (char const* first, char const* last) noexcept {
+#if defined(__x86_64__)
+  static bool const vectorized = __builtin_cpu_supports("avx2");
+  if (vectorized) { return ::search(first, last); }
+#endif /* defined(__x86_64__) */
+  auto found = std::memchr(first, '\n', static_cast<size_t>(last - first));
+  return found ? static_cast<char const*>(found) : last;
+}
+
+bool contains (std::string_view haystack, std::string_view needle) noexcept {
+  auto equal = [] (unsigned char x, unsigned char y) noexcept { return std::toupper(x) == std::toupper(y); };
+  auto found = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), equal);
+  return found != haystack.end();
+}
+
+// The same rules as column::type, except that an undeclared type keeps the
+// field as text.
+affinity classify (std::string_view declared) noexcept {
+  if (contains(declared, "INT")) { return affinity::integer; }
+  if (contains(declared, "CHAR")) { return affinity::text; }
+  if (contains(declared, "CLOB")) { return affinity::text; }
+  if (contains(declared, "TEXT")) { return affinity::text; }
+  if (contains(declared, "BLOB") or declared.empty()) { return affinity::blob; }
+  if (contains(declared, "REAL")) { return affinity::real; }
+  if (contains(declared, "FLOA")) { return affinity::real; }
+  if (contains(declared, "DOUB")) { return affinity::real; }
+  return affinity::numeric;
+}
+
+/* A whole file, mapped read only for as long as this lives */
+struct region final {
+  explicit region (std::filesystem::path const& path) noexcept(false) {
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { throw std::system_error(error::cannot_open_resource); }
+    struct stat info { };
+    if (::fstat(fd, &info) < 0) {
+      ::close(fd);
+      throw std::system_error(error::cannot_open_resource);
+    }
+    this->size = static_cast<size_t>(info.st_size);
+    // An empty file cannot be mapped, and needs nothing to be
+    auto ptr = this->size ? ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    ::close(fd);
+    if (ptr == MAP_FAILED) { throw std::system_error(error::not_enough_memory); }
+    if (ptr) { ::madvise(ptr, this->size, MADV_SEQUENTIAL); }
+    this->data = static_cast<char const*>(ptr);
+  }
+
+  region (region const&) = delete;
+  ~region () noexcept {
+    if (this->data) { ::munmap(const_cast<char*>(this->data), this->size); }
+  }
+
+  char const* data { };
+  size_t size { };
+};
+
+/* Where a field lies within its line */
+struct field final {
+  size_t offset;
+  size_t size;
+  /* Quoted, and containing doubled quotes */
+  bool escaped;
+};
+
+void split (std::string_view line, flatfile::delimited const& format, std::vector<field>& fields) {
+  fields.clear();
+  size_t position = 0;
+  while (true) {
+    if (format.quote and position < line.size() and line[position] == format.quote) {
+      auto const start = position + 1;
+      auto idx = start;
+      bool escaped = false;
+      for (; idx < line.size(); ++idx) {
+        if (line[idx] != format.quote) { continue; }
+        if (idx + 1 < line.size() and line[idx + 1] == format.quote) {
+          escaped = true;
+          ++idx;
+          continue;
+        }
+        break;
+      }
+      fields.push_back(field { start, std::min(idx, line.size()) - start, escaped });
+      position = line.find(format.separator, idx);
+      if (position == std::string_view::npos) { return; }
+      ++position;
+      continue;
+    }
+    auto const found = line.find(format.separator, position);
+    if (found == std::string_view::npos) {
+      fields.push_back(field { position, line.size() - position, false });
+      return;
+    }
+    fields.push_back(field { position, found - position, false });
+    position = found + 1;
+  }
+}
+
+void split (std::string_view line, flatfile::fixed const& format, std::vector<field>& fields) {
+  fields.clear();
+  size_t position = 0;
+  for (auto width : format.widths) {
+    if (position >= line.size()) { return; }
+    auto const size = std::min(width, line.size() - position);
+    auto text = line.substr(position, size);
+    auto const head = text.find_first_not_of(' ');
+    if (head == std::string_view::npos) { fields.push_back(field { position, 0, false }); }
+    else {
+      auto const tail = text.find_last_not_of(' ');
+      fields.push_back(field { position + head, tail - head + 1, false });
+    }
+    position += width;
+  }
+}
+
+std::string unescape (std::string_view text, char quote) {
+  std::string result;
+  result.reserve(text.size());
+  for (size_t idx = 0; idx < text.size(); ++idx) {
+    result += text[idx];
+    if (text[idx] == quote and idx + 1 < text.size() and text[idx + 1] == quote) { ++idx; }
+  }
+  return result;
+}
+
+/* Results a number if the whole (trimmed) field is one */
+bool number (apex::sqlite::context const& ctx, std::string_view text, affinity type) noexcept {
+  auto const head = text.find_first_not_of(' ');
+  if (head == std::string_view::npos) { return false; }
+  text = text.substr(head, text.find_last_not_of(' ') - head + 1);
+  auto const first = text.data();
+  auto const last = text.data() + text.size();
+  if (type != affinity::real) {
+    i64 integer { };
+    auto [end, code] = std::from_chars(first, last, integer);
+    if (code == std::errc { } and end == last) {
+      ctx = integer;
+      return true;
+    }
+  }
+  double real { };
+  auto [end, code] = std::from_chars(first, last, real);
+  if (code != std::errc { } or end != last) { return false; }
+  ctx = real;
+  return true;
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+struct flatfile::mapping final {
+  mapping (std::filesystem::path const& path, format_type format, std::vector<std::string> const& columns) noexcept(false) :
+    memory { path },
+    format { std::move(format) }
+  {
+    auto const header = std::holds_alternative<delimited>(this->format)
+      and std::get<delimited>(this->format).header;
+    if (header) { this->start = this->next(0); }
+    // Only declarations are split into a name and a type, as a header may
+    // name a column anything at all.
+    for (auto const& declaration : columns) {
+      auto const space = declaration.find(' ');
+      this->names.push_back(declaration.substr(0, space));
+      this->declared.push_back(space == std::string::npos ? std::string { } : declaration.substr(space + 1));
+    }
+    if (this->names.empty()) { this->name(header); }
+    this->marks.push_back(this->start);
+    for (auto const& type : this->declared) { this->types.push_back(::classify(type)); }
+  }
+
+  mapping (mapping const&) = delete;
+
+  /* Offset of the line after the one at the given offset */
+  size_t next (size_t offset) const noexcept {
+    auto const end = this->memory.data + this->memory.size;
+    auto const found = ::newline(this->memory.data + offset, end);
+    return found == end ? this->memory.size : static_cast<size_t>(found - this->memory.data) + 1;
+  }
+
+  /* The line at the given offset, without its line ending */
+  std::string_view line (size_t offset) const noexcept {
+    auto const end = this->memory.data + this->memory.size;
+    auto const found = ::newline(this->memory.data + offset, end);
+    std::string_view text { this->memory.data + offset, static_cast<size_t>(found - this->memory.data) - offset };
+    if (not text.empty() and text.back() == '\r') { text.remove_suffix(1); }
+    return text;
+  }
+
+  void split (std::string_view line, std::vector<field>& fields) const {
+    std::visit([&] (auto const& format) { ::split(line, format, fields); }, this->format);
+  }
+
+  /* Offset of the (1-based) line, or npos if there is no such line */
+  size_t locate (i64 line) noexcept(false) {
+    if (line < 1) { return npos; }
+    auto const idx = static_cast<size_t>(line - 1);
+    std::unique_lock lock { this->mutex };
+    while (this->marks.size() * stride <= idx and this->total == npos) { this->extend(); }
+    if (idx >= this->total) { return npos; }
+    auto offset = this->marks[idx / stride];
+    lock.unlock();
+    for (auto count = idx % stride; count; --count) { offset = this->next(offset); }
+    return offset;
+  }
+
+  size_t count () noexcept(false) {
+    std::lock_guard lock { this->mutex };
+    while (this->total == npos) { this->extend(); }
+    return this->total;
+  }
+
+  ::region memory;
+  /* Offset of the first row */
+  size_t start { };
+  format_type format;
+  std::vector<std::string> names;
+  /* The declared type of each column, which may be empty */
+  std::vector<std::string> declared;
+  std::vector<affinity> types;
+
+private:
+  /* Records the next mark, or the total once the end is reached */
+  void extend () noexcept(false) {
+    auto offset = this->marks.back();
+    for (size_t idx = 0; idx < stride; ++idx) {
+      if (offset >= this->memory.size) {
+        this->total = (this->marks.size() - 1) * stride + idx;
+        return;
+      }
+      offset = this->next(offset);
+    }
+    if (offset >= this->memory.size) { this->total = this->marks.size() * stride; }
+    else { this->marks.push_back(offset); }
+  }
+
+  void name (bool header) noexcept(false) {
+    std::vector<field> fields;
+    if (this->memory.size) { this->split(this->line(0), fields); }
+    if (auto format = std::get_if<fixed>(&this->format)) { fields.resize(format->widths.size()); }
+    auto const quote = header ? std::get<delimited>(this->format).quote : '\0';
+    for (size_t idx = 0; idx < fields.size(); ++idx) {
+      auto const text = this->line(0).substr(fields[idx].offset, fields[idx].size);
+      if (header) { this->names.push_back(::unescape(text, quote)); }
+      else { this->names.push_back("c" + std::to_string(idx + 1)); }
+      this->declared.emplace_back();
+    }
+    if (this->names.empty()) { throw std::system_error(error::inappropriate_operation); }
+  }
+
+  std::mutex mutex;
+  std::vector<size_t> marks;
+  size_t total { npos };
+};
+
+struct flatfile::scanner final : cursor {
+  explicit scanner (std::shared_ptr<mapping> data) noexcept :
+    data { std::move(data) }
+  { }
+
+  void filter (sqlite::filter const& plan, std::any args) noexcept(false) override {
+    auto const& values = std::any_cast<span<value const> const&>(args);
+    i64 first = 1;
+    this->last = std::numeric_limits<i64>::max();
+    planner::choice const choice { plan };
+    if (choice.terms.size() != values.size()) { throw std::system_error(error::inappropriate_operation); }
+    for (size_t idx = 0; idx < values.size(); ++idx) {
+      auto const& item = values[idx];
+      // Anything but an integer is left for sqlite to compare
+      if (sqlite3_value_type(item.get()) != SQLITE_INTEGER) { continue; }
+      auto const bound = static_cast<i64>(item);
+      switch (choice.terms[idx].op) {
+        case restraint::equal_to:
+          first = std::max(first, bound);
+          this->last = std::min(this->last, bound);
+          break;
+        case restraint::greater:
+          if (bound == std::numeric_limits<i64>::max()) { this->last = 0; }
+          else { first = std::max(first, bound + 1); }
+          break;
+        case restraint::greater_equal: first = std::max(first, bound); break;
+        case restraint::less: this->last = std::min(this->last, std::max<i64>(bound, 1) - 1); break;
+        case restraint::less_equal: this->last = std::min(this->last, bound); break;
+        default: break;
+      }
+    }
+    this->number = first;
+    this->offset = first == 1 ? this->data->start : this->data->locate(first);
+    if (first > this->last) { this->offset = npos; }
+    this->load();
+  }
+
+  void column (context& ctx, i32 idx) noexcept(false) override {
+    if (not this->split) {
+      this->data->split(this->text, this->fields);
+      this->split = true;
+    }
+    if (static_cast<size_t>(idx) >= this->fields.size()) { return; }
+    auto const& item = this->fields[static_cast<size_t>(idx)];
+    auto const value = this->text.substr(item.offset, item.size);
+    auto const type = this->data->types[static_cast<size_t>(idx)];
+    auto const numeric = type == affinity::integer or type == affinity::real or type == affinity::numeric;
+    if (numeric and ::number(ctx, value, type)) { return; }
+    if (item.escaped) {
+      ctx = ::unescape(value, std::get<delimited>(this->data->format).quote);
+      return;
+    }
+    // The mapping outlives every statement that reads from it
+    auto const size = static_cast<sqlite3_uint64>(value.size());
+    sqlite3_result_text64(ctx.get(), value.data(), size, SQLITE_STATIC, SQLITE_UTF8);
+  }
+
+  void next () noexcept(false) override {
+    if (this->number >= this->last) { this->offset = npos; }
+    else {
+      this->offset = this->data->next(this->offset);
+      ++this->number;
+    }
+    this->load();
+  }
+
+  bool ended () const noexcept override { return this->offset == npos; }
+  i64 row () noexcept override { return this->number; }
+
+private:
+  void load () noexcept {
+    this->split = false;
+    if (this->offset != npos and this->offset >= this->data->memory.size) { this->offset = npos; }
+    if (this->offset == npos) { return; }
+    this->text = this->data->line(this->offset);
+  }
+
+  std::shared_ptr<mapping> data;
+  std::vector<field> fields;
+  std::string_view text;
+  size_t offset { npos };
+  i64 number { };
+  i64 last { };
+  bool split { false };
+};
+
+flatfile::flatfile (std::filesystem::path const& path, format_type format, std::vector<std::string> columns) noexcept(false) :
+  data { std::make_shared<mapping>(path, std::move(format), columns) }
+{ }
+
+flatfile::flatfile (std::filesystem::path const& path, format_type format) noexcept(false) :
+  flatfile { path, std::move(format), { } }
+{ }
+
+flatfile::flatfile (std::shared_ptr<mapping> data) noexcept :
+  data { std::move(data) }
+{ }
+
+size_t flatfile::lines () noexcept(false) { return this->data->count(); }
+
+std::shared_ptr<table> flatfile::clone () const noexcept(false) {
+  return std::shared_ptr<flatfile>(new flatfile { this->data });
+}
+
+void flatfile::connect (std::any) noexcept(false) { }
+void flatfile::create (std::any) noexcept(false) { }
+
+void flatfile::disconnect () noexcept(false) { }
+void flatfile::destroy () noexcept(false) { }
+
+std::shared_ptr<cursor> flatfile::iterator () const noexcept(false) {
+  return std::make_shared<scanner>(this->data);
+}
+
+// Only constraints on the rowid are used. Until every line has been counted,
+// lines are assumed to average 80 bytes.
+index::output const& flatfile::access (index::input const& input) noexcept(false) {
+  auto const rows = std::max(static_cast<f64>(this->data->memory.size) / 80.0, 1.0);
+  planner { rows }
+    .support(-1, { .restraints = planner::ranges, .distinct = rows, .seek = true })
+    .plan(input, this->plan);
+  return this->plan;
+}
+
+string flatfile::schema () noexcept(false) {
+  string text { "CREATE TABLE x(" };
+  for (size_t idx = 0; idx < this->data->names.size(); ++idx) {
+    text += '"';
+    for (auto c : this->data->names[idx]) {
+      if (c == '"') { text += '"'; }
+      text += c;
+    }
+    text += '"';
+    if (auto const& type = this->data->declared[idx]; not type.empty()) {
+      text += ' ';
+      text += type;
+    }
+    text += ", ";
+  }
+  text.resize(text.size() - 2);
+  text += ')';
+  return text;
+}
+
+void flatfile::rename (char const*) noexcept(false) { }
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,54 @@
+#include <apex/sqlite/histogram.hpp>
+#include <apex/core/bit.hpp>
+
+namespace {
+
+// The largest value bucket idx holds, i.e., 2^idx - 1. This is computed in
+// u64, as the last bucket's bound only just fits in an i64.
+apex::sqlite::histogram::duration upper (size_t idx) noexcept {
+  using duration = apex::sqlite::histogram::duration;
+  if (idx >= 63) { return duration::max(); }
+  return duration { static_cast<apex::i64>((apex::u64 { 1 } << idx) - 1) };
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+u64 histogram::operator [] (size_t idx) const noexcept {
+  return this->counts[idx].load(std::memory_order_relaxed);
+}
+
+void histogram::record (duration elapsed) noexcept {
+  auto const ns = static_cast<u64>(elapsed.count() < 0 ? 0 : elapsed.count());
+  auto const idx = ns ? static_cast<size_t>(64 - countl_zero(ns)) : 0;
+  this->counts[idx < buckets ? idx : buckets - 1].fetch_add(1, std::memory_order_relaxed);
+  this->sum.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void histogram::clear () noexcept {
+  for (auto& count : this->counts) { count.store(0, std::memory_order_relaxed); }
+  this->sum.store(0, std::memory_order_relaxed);
+}
+
+histogram::duration histogram::percentile (f64 rank) const noexcept {
+  auto const target = static_cast<u64>(rank * static_cast<f64>(this->count()));
+  u64 seen = 0;
+  for (size_t idx = 0; idx < buckets; ++idx) {
+    seen += (*this)[idx];
+    if (seen > target) { return ::upper(idx); }
+  }
+  return duration::max();
+}
+
+histogram::duration histogram::total () const noexcept {
+  return duration { static_cast<i64>(this->sum.load(std::memory_order_relaxed)) };
+}
+
+u64 histogram::count () const noexcept {
+  u64 total = 0;
+  for (auto const& count : this->counts) { total += count.load(std::memory_order_relaxed); }
+  return total;
+}
+
+} /* namespace apex::sqlite */
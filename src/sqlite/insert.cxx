@@ -0,0 +1,29 @@
+#include <apex/sqlite/insert.hpp>
+#include <sqlite3.h>
+
+namespace apex::detail::sqlite {
+
+std::string insertion (std::string_view table, size_t columns, size_t rows) noexcept(false) {
+  static constexpr std::string_view prefix = "INSERT INTO ";
+  static constexpr std::string_view values = " VALUES ";
+  auto const width = columns * 2 + 1;
+  std::string sql;
+  sql.reserve(prefix.size() + table.size() + values.size() + rows * (width + 1));
+  sql.append(prefix).append(table).append(values);
+  for (size_t row = 0; row < rows; ++row) {
+    if (row) { sql += ','; }
+    sql += '(';
+    for (size_t column = 0; column < columns; ++column) {
+      if (column) { sql += ','; }
+      sql += '?';
+    }
+    sql += ')';
+  }
+  return sql;
+}
+
+size_t variables (connection const& conn) noexcept {
+  return static_cast<size_t>(sqlite3_limit(conn.get(), SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+}
+
+} /* namespace apex::detail::sqlite */
@@ -0,0 +1,151 @@
+#include <apex/sqlite/memoize.hpp>
+#include <apex/sqlite/context.hpp>
+#include <apex/sqlite/value.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <array>
+#include <bit>
+
+namespace {
+
+using apex::sqlite::recording;
+using apex::sqlite::function_t;
+using apex::sqlite::memoize;
+using apex::sqlite::context;
+using apex::u64;
+using apex::u8;
+
+using key_type = std::array<char, memoize::limit>;
+
+struct entry final {
+  key_type key;
+  size_t hash;
+  u8 size;
+  bool used;
+  recording value;
+};
+
+struct memo final {
+  function_t function;
+  std::vector<entry> entries;
+};
+
+// Writes each argument's type, followed by its value (and the length of a
+// TEXT or BLOB, so that no two sets of arguments share a key). Returns false
+// if they do not fit.
+bool serialize (context const& ctx, key_type& key, size_t& size) noexcept {
+  size = 0;
+  auto append = [&] (void const* data, size_t length) noexcept {
+    if (length > key.size() - size) { return false; }
+    if (length) { std::memcpy(key.data() + size, data, length); }
+    size += length;
+    return true;
+  };
+  for (ptrdiff_t idx = 0; idx < ctx.size(); ++idx) {
+    auto const item = ctx[idx].get();
+    auto const type = static_cast<char>(sqlite3_value_type(item));
+    if (not append(&type, 1)) { return false; }
+    switch (type) {
+      case SQLITE_INTEGER: {
+        auto const number = sqlite3_value_int64(item);
+        if (not append(&number, sizeof(number))) { return false; }
+        break;
+      }
+      case SQLITE_FLOAT: {
+        auto const number = sqlite3_value_double(item);
+        if (not append(&number, sizeof(number))) { return false; }
+        break;
+      }
+      case SQLITE_TEXT:
+      case SQLITE_BLOB: {
+        auto const data = type == SQLITE_TEXT
+          ? static_cast<void const*>(sqlite3_value_text(item))
+          : sqlite3_value_blob(item);
+        auto const length = static_cast<u8>(std::min(sqlite3_value_bytes(item), 255));
+        if (length == 255) { return false; }
+        if (not append(&length, 1) or not append(data, length)) { return false; }
+        break;
+      }
+      default: break;
+    }
+  }
+  return true;
+}
+
+void replay (context const& ctx, recording::result_type const& result) noexcept {
+  switch (result.index()) {
+    case 0: sqlite3_result_null(ctx.get()); break;
+    case 1: ctx = std::get<1>(result); break;
+    case 2: ctx = std::get<2>(result); break;
+    case 3: ctx = std::string_view { std::get<3>(result) }; break;
+    case 4: {
+      auto const& blob = std::get<4>(result);
+      auto const size = static_cast<sqlite3_uint64>(blob.size());
+      sqlite3_result_blob64(ctx.get(), blob.data(), size, SQLITE_TRANSIENT);
+      break;
+    }
+  }
+}
+
+void invoke (sqlite3_context* ptr, int argc, sqlite3_value** argv) noexcept {
+  context ctx { ptr, argc, argv };
+  auto& cache = *static_cast<memo*>(sqlite3_user_data(ptr));
+  key_type key;
+  size_t size = 0;
+  if (not ::serialize(ctx, key, size)) {
+    try { cache.function(ctx); }
+    catch (...) { ctx = std::current_exception(); }
+    return;
+  }
+
+  auto const hash = std::hash<std::string_view> { }(std::string_view { key.data(), size });
+  auto const set = cache.entries.data() + (hash & (cache.entries.size() / 2 - 1)) * 2;
+  auto matches = [&] (entry const& item) noexcept {
+    return item.used
+      and item.hash == hash
+      and item.size == size
+      and not std::memcmp(item.key.data(), key.data(), size);
+  };
+  // Each set keeps its most recently used entry first
+  if (matches(set[1])) { std::swap(set[0], set[1]); }
+  if (matches(set[0])) { return ::replay(ctx, set[0].value.result); }
+
+  recording value;
+  ctx.record(&value);
+  try { cache.function(ctx); }
+  catch (...) {
+    ctx = std::current_exception();
+    return;
+  }
+  if (value.failed) { return; }
+  std::swap(set[0], set[1]);
+  auto& slot = set[0];
+  std::memcpy(slot.key.data(), key.data(), size);
+  slot.hash = hash;
+  slot.size = static_cast<u8>(size);
+  slot.used = true;
+  slot.value = std::move(value);
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+void function (connection& conn, std::string_view name, ptrdiff_t argc, memoize options, function_t function) noexcept(false) {
+  auto cache = std::make_unique<memo>();
+  cache->function = function;
+  cache->entries.resize(std::bit_ceil(std::max<size_t>(options.entries, 2)));
+  auto destructor = [] (void* ptr) noexcept { delete static_cast<memo*>(ptr); };
+  std::string const label { name };
+  // sqlite calls the destructor itself if this fails
+  auto const result = sqlite3_create_function_v2(
+    conn.get(), label.c_str(), static_cast<int>(argc), SQLITE_UTF8 | SQLITE_DETERMINISTIC, cache.release(),
+    ::invoke, nullptr, nullptr, destructor);
+  if (result) { throw std::system_error(error(result)); }
+}
+
+} /* namespace apex::sqlite */
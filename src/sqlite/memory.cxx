@@ -0,0 +1,345 @@
+#include <apex/sqlite/memory.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/core/bit.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <limits>
+#include <vector>
+#include <array>
+#include <mutex>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+using apex::i64;
+using apex::u32;
+using apex::u64;
+
+// Every block starts with a 16 byte header, which keeps the payload 16 byte
+// aligned (sqlite only requires 8).
+struct header final {
+  u64 size;
+  u32 index;
+  u32 padding;
+};
+static_assert(sizeof(header) == 16);
+
+constexpr u32 unpooled = std::numeric_limits<u32>::max();
+constexpr size_t slab_size = 1024 * 1024;
+constexpr size_t largest = 32 * 1024;
+
+// 16 byte steps up to 128, and then four classes per power of two. This keeps
+// internal fragmentation under 25%, while the common sqlite allocations
+// (cursors, pages + their pcache header, lookaside) land in their own class.
+constexpr auto sizes = [] {
+  std::array<size_t, 40> items { };
+  size_t idx = 0;
+  for (size_t size = 16; size <= 128; size += 16) { items[idx++] = size; }
+  for (size_t base = 128; base < largest; base *= 2) {
+    for (size_t step = 1; step <= 4; ++step) { items[idx++] = base + base / 4 * step; }
+  }
+  return items;
+}();
+constexpr size_t classes = sizes.size();
+static_assert(sizes.back() == largest);
+
+constexpr size_t batch_of (size_t index) noexcept {
+  return std::clamp<size_t>(64 * 1024 / sizes[index], 4, 64);
+}
+
+size_t class_of (size_t size) noexcept {
+  auto found = std::lower_bound(sizes.begin(), sizes.end(), size);
+  return static_cast<size_t>(found - sizes.begin());
+}
+
+struct block final { block* next; };
+
+header* header_of (void* ptr) noexcept {
+  return reinterpret_cast<header*>(static_cast<char*>(ptr) - sizeof(header));
+}
+
+void* payload_of (void* ptr) noexcept { return static_cast<char*>(ptr) + sizeof(header); }
+
+/* Shared free lists, which thread caches refill from and spill into */
+struct depot final {
+  struct bin final {
+    std::mutex mutex;
+    block* head { };
+  };
+
+  // Carves fresh blocks out of the current slab. Slabs are never freed.
+  void* carve (size_t size) noexcept {
+    std::lock_guard lock { this->mutex };
+    if (static_cast<size_t>(this->end - this->cursor) < size) {
+      auto slab = static_cast<char*>(std::malloc(slab_size));
+      if (not slab) { return nullptr; }
+      this->cursor = slab;
+      this->end = slab + slab_size;
+    }
+    return std::exchange(this->cursor, this->cursor + size);
+  }
+
+  std::array<bin, classes> bins;
+  std::mutex mutex;
+  char* cursor { };
+  char* end { };
+};
+
+depot& shared () noexcept {
+  static depot instance;
+  return instance;
+}
+
+/* Outstanding block counts. These are only ever written by their owning
+ * thread, so a load + store is enough, and no cache line is shared between
+ * threads on the hot path.
+ */
+using counters = std::array<std::atomic<i64>, classes>;
+
+struct registry final {
+  std::mutex mutex;
+  std::vector<counters*> threads;
+  counters retired { };
+  std::atomic<i64> unpooled { };
+};
+
+registry& statistics () noexcept {
+  static registry instance;
+  return instance;
+}
+
+void bump (counters& items, size_t index, i64 delta) noexcept {
+  auto& item = items[index];
+  item.store(item.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct cache final {
+  struct bin final {
+    block* head { };
+    size_t count { };
+  };
+
+  cache () noexcept {
+    auto& stats = statistics();
+    std::lock_guard lock { stats.mutex };
+    stats.threads.push_back(std::addressof(this->outstanding));
+  }
+
+  ~cache () noexcept {
+    for (size_t idx = 0; idx < classes; ++idx) { this->spill(idx, this->bins[idx].count); }
+    auto& stats = statistics();
+    std::lock_guard lock { stats.mutex };
+    for (size_t idx = 0; idx < classes; ++idx) {
+      stats.retired[idx].fetch_add(this->outstanding[idx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    std::erase(stats.threads, std::addressof(this->outstanding));
+  }
+
+  void* pop (size_t index) noexcept {
+    auto& bin = this->bins[index];
+    if (not bin.head and not this->refill(index)) { return nullptr; }
+    auto item = std::exchange(bin.head, bin.head->next);
+    --bin.count;
+    bump(this->outstanding, index, 1);
+    return item;
+  }
+
+  void push (size_t index, void* ptr) noexcept {
+    auto& bin = this->bins[index];
+    auto item = static_cast<block*>(ptr);
+    item->next = std::exchange(bin.head, item);
+    bump(this->outstanding, index, -1);
+    if (++bin.count > batch_of(index) * 2) { this->spill(index, batch_of(index)); }
+  }
+
+private:
+  bool refill (size_t index) noexcept {
+    auto& bin = this->bins[index];
+    auto& source = shared().bins[index];
+    auto const count = batch_of(index);
+    {
+      std::lock_guard lock { source.mutex };
+      while (source.head and bin.count < count) {
+        auto item = std::exchange(source.head, source.head->next);
+        item->next = std::exchange(bin.head, item);
+        ++bin.count;
+      }
+    }
+    auto const stride = sizeof(header) + sizes[index];
+    if (bin.count) { return true; }
+    auto memory = static_cast<char*>(shared().carve(stride * count));
+    if (not memory) { return false; }
+    for (size_t idx = 0; idx < count; ++idx) {
+      auto item = reinterpret_cast<header*>(memory + idx * stride);
+      *item = header { sizes[index], static_cast<u32>(index), 0 };
+      auto free = static_cast<block*>(payload_of(item));
+      free->next = std::exchange(bin.head, free);
+    }
+    bin.count = count;
+    return true;
+  }
+
+  void spill (size_t index, size_t count) noexcept {
+    auto& bin = this->bins[index];
+    if (not count) { return; }
+    auto first = bin.head;
+    auto last = first;
+    for (size_t idx = 1; idx < count; ++idx) { last = last->next; }
+    bin.head = std::exchange(last->next, nullptr);
+    bin.count -= count;
+    auto& target = shared().bins[index];
+    std::lock_guard lock { target.mutex };
+    last->next = std::exchange(target.head, first);
+  }
+
+  std::array<bin, classes> bins { };
+  counters outstanding { };
+};
+
+// sqlite can free memory during thread (or process) teardown, after the
+// thread's cache has been destroyed. Those calls go to the depot directly.
+thread_local bool finished = false;
+struct guard final {
+  ~guard () noexcept { finished = true; }
+  cache instance;
+};
+thread_local guard local;
+
+cache* current () noexcept { return finished ? nullptr : std::addressof(local.instance); }
+
+void* pool_malloc (int requested) noexcept {
+  auto const size = static_cast<size_t>(std::max(requested, 1));
+  if (size > largest) {
+    auto item = static_cast<header*>(std::malloc(sizeof(header) + size));
+    if (not item) { return nullptr; }
+    *item = header { size, unpooled, 0 };
+    statistics().unpooled.fetch_add(static_cast<i64>(size), std::memory_order_relaxed);
+    return payload_of(item);
+  }
+  auto const index = class_of(size);
+  if (auto cache = current()) { return cache->pop(index); }
+  // Only reachable during thread teardown, so skip the thread cache
+  auto& source = shared().bins[index];
+  std::unique_lock lock { source.mutex };
+  if (auto item = source.head) {
+    source.head = item->next;
+    statistics().retired[index].fetch_add(1, std::memory_order_relaxed);
+    return item;
+  }
+  lock.unlock();
+  auto item = static_cast<header*>(shared().carve(sizeof(header) + sizes[index]));
+  if (not item) { return nullptr; }
+  *item = header { sizes[index], static_cast<u32>(index), 0 };
+  statistics().retired[index].fetch_add(1, std::memory_order_relaxed);
+  return payload_of(item);
+}
+
+void pool_free (void* ptr) noexcept {
+  if (not ptr) { return; }
+  auto item = header_of(ptr);
+  if (item->index == unpooled) {
+    statistics().unpooled.fetch_sub(static_cast<i64>(item->size), std::memory_order_relaxed);
+    return std::free(item);
+  }
+  if (auto cache = current()) { return cache->push(item->index, ptr); }
+  auto& target = shared().bins[item->index];
+  statistics().retired[item->index].fetch_sub(1, std::memory_order_relaxed);
+  std::lock_guard lock { target.mutex };
+  static_cast<block*>(ptr)->next = std::exchange(target.head, static_cast<block*>(ptr));
+}
+
+int pool_size (void* ptr) noexcept {
+  return ptr ? static_cast<int>(header_of(ptr)->size) : 0;
+}
+
+void* pool_realloc (void* ptr, int requested) noexcept {
+  if (not ptr) { return pool_malloc(requested); }
+  auto const size = static_cast<size_t>(std::max(requested, 1));
+  auto const current = static_cast<size_t>(pool_size(ptr));
+  // Stay put if the block is big enough and we would not drop a size class
+  if (size <= current and (current > largest or class_of(size) == header_of(ptr)->index)) {
+    return ptr;
+  }
+  auto result = pool_malloc(requested);
+  if (not result) { return nullptr; }
+  std::memcpy(result, ptr, std::min(size, current));
+  pool_free(ptr);
+  return result;
+}
+
+int pool_roundup (int requested) noexcept {
+  auto const size = static_cast<size_t>(std::max(requested, 1));
+  if (size > largest) { return (requested + 7) & ~7; }
+  return static_cast<int>(sizes[class_of(size)]);
+}
+
+int pool_init (void*) noexcept { return SQLITE_OK; }
+void pool_shutdown (void*) noexcept { }
+
+sqlite3_mem_methods const pooled {
+  pool_malloc,
+  pool_free,
+  pool_realloc,
+  pool_size,
+  pool_roundup,
+  pool_init,
+  pool_shutdown,
+  nullptr
+};
+
+std::atomic<bool> installed { false };
+
+i64 outstanding (size_t index) noexcept {
+  auto& stats = statistics();
+  std::lock_guard lock { stats.mutex };
+  auto total = stats.retired[index].load(std::memory_order_relaxed);
+  for (auto thread : stats.threads) { total += (*thread)[index].load(std::memory_order_relaxed); }
+  return total;
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+void install (allocator kind) noexcept(false) {
+  static sqlite3_mem_methods system = [] {
+    sqlite3_mem_methods methods { };
+    sqlite3_config(SQLITE_CONFIG_GETMALLOC, &methods);
+    return methods;
+  }();
+  auto const pooling = kind == allocator::pooled;
+  auto const& methods = pooling ? ::pooled : system;
+  if (auto result = sqlite3_config(SQLITE_CONFIG_MALLOC, &methods)) {
+    throw std::system_error(error(result));
+  }
+  sqlite3_config(SQLITE_CONFIG_MEMSTATUS, static_cast<int>(not pooling));
+  installed.store(pooling, std::memory_order_relaxed);
+}
+
+void* reallocate (void* ptr, size_t size) { return sqlite3_realloc64(ptr, size); }
+void* allocate (size_t size) { return sqlite3_malloc64(size); }
+void deallocate (void* ptr) { sqlite3_free(ptr); }
+
+size_t allocated () noexcept {
+  if (not installed.load(std::memory_order_relaxed)) {
+    return static_cast<size_t>(sqlite3_memory_used());
+  }
+  auto total = statistics().unpooled.load(std::memory_order_relaxed);
+  for (size_t idx = 0; idx < classes; ++idx) {
+    total += outstanding(idx) * static_cast<i64>(sizes[idx]);
+  }
+  return static_cast<size_t>(std::max(total, i64 { 0 }));
+}
+
+size_t allocated (size_t size) noexcept {
+  if (not installed.load(std::memory_order_relaxed) or size > largest) { return 0; }
+  auto const index = ::class_of(std::max(size, size_t { 1 }));
+  return static_cast<size_t>(std::max(outstanding(index), i64 { 0 })) * sizes[index];
+}
+
+} /* namespace apex::sqlite */
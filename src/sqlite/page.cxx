@@ -0,0 +1,373 @@
+#include <apex/sqlite/page.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include <cstring>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+namespace {
+
+using apex::u64;
+
+constexpr size_t slab_size = 2 * 1024 * 1024;
+
+/* Every page is laid out as [slot][buffer][extra]. sqlite only ever sees the
+ * embedded sqlite3_pcache_page, which is the first member, so the slot is
+ * recovered with a cast.
+ */
+struct slot final {
+  sqlite3_pcache_page page;
+  slot* next;
+  unsigned key;
+  bool pinned;
+  bool referenced;
+  bool live;
+};
+
+constexpr size_t header_size = (sizeof(slot) + 15) & ~size_t { 15 };
+
+slot* slot_of (sqlite3_pcache_page* page) noexcept { return reinterpret_cast<slot*>(page); }
+
+void* map_slab () noexcept {
+  auto const flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (auto ptr = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0); ptr != MAP_FAILED) {
+    return ptr;
+  }
+  // No reserved huge pages. Over-map so the slab can be 2MiB aligned, which
+  // is what lets the kernel back it with a transparent huge page.
+  auto raw = mmap(nullptr, slab_size * 2, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (raw == MAP_FAILED) { return nullptr; }
+  auto const start = reinterpret_cast<uintptr_t>(raw);
+  auto const aligned = (start + slab_size - 1) & ~(slab_size - 1);
+  if (auto const head = aligned - start) { munmap(raw, head); }
+  if (auto const tail = slab_size - (aligned - start)) {
+    munmap(reinterpret_cast<void*>(aligned + slab_size), tail);
+  }
+  auto ptr = reinterpret_cast<void*>(aligned);
+  madvise(ptr, slab_size, MADV_HUGEPAGE);
+  return ptr;
+}
+
+/* Free slots, shared by every cache with the same stride */
+struct shelf final {
+  slot* head { };
+};
+
+struct counters final {
+  std::atomic<u64> hits { };
+  std::atomic<u64> misses { };
+  std::atomic<u64> evictions { };
+};
+
+struct registry final {
+  std::mutex mutex;
+  std::unordered_map<size_t, shelf> shelves;
+  std::vector<counters*> caches;
+  counters retired;
+  std::atomic<u64> slabs { };
+};
+
+registry& shared () noexcept {
+  static registry instance;
+  return instance;
+}
+
+void bump (std::atomic<u64>& item) noexcept {
+  item.store(item.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/* sqlite only ever uses a cache instance from the connection that owns it,
+ * so nothing but the shelves needs a lock.
+ */
+struct cache final {
+  cache (int page, int extra, bool purgeable) noexcept :
+    stride { (header_size + static_cast<size_t>(page) + static_cast<size_t>(extra) + 15) & ~size_t { 15 } },
+    page { static_cast<size_t>(page) },
+    extra { static_cast<size_t>(extra) },
+    purgeable { purgeable }
+  {
+    auto& items = shared();
+    std::lock_guard lock { items.mutex };
+    items.caches.push_back(std::addressof(this->stats));
+  }
+
+  ~cache () noexcept {
+    auto& items = shared();
+    std::lock_guard lock { items.mutex };
+    this->surrender(true);
+    for (auto [target, source] : {
+      std::pair { &items.retired.hits, &this->stats.hits },
+      std::pair { &items.retired.misses, &this->stats.misses },
+      std::pair { &items.retired.evictions, &this->stats.evictions },
+    }) { target->fetch_add(source->load(std::memory_order_relaxed), std::memory_order_relaxed); }
+    std::erase(items.caches, std::addressof(this->stats));
+  }
+
+  sqlite3_pcache_page* fetch (unsigned key, int create) noexcept {
+    if (auto found = this->index.find(key); found != this->index.end()) {
+      auto item = found->second;
+      item->pinned = true;
+      item->referenced = true;
+      bump(this->stats.hits);
+      return &item->page;
+    }
+    bump(this->stats.misses);
+    if (not create) { return nullptr; }
+    auto item = this->obtain(create == 2);
+    if (not item) { return nullptr; }
+    item->key = key;
+    item->pinned = true;
+    item->referenced = true;
+    item->live = true;
+    // sqlite relies on the start of the extra space being zeroed for new pages
+    std::memset(item->page.pExtra, 0, this->extra);
+    this->index.emplace(key, item);
+    return &item->page;
+  }
+
+  void unpin (sqlite3_pcache_page* page, bool discard) noexcept {
+    auto item = slot_of(page);
+    item->pinned = false;
+    if (discard or not this->purgeable) {
+      if (discard) { this->discard(item); }
+      return;
+    }
+    // Over capacity (e.g. after create == 2): give the page straight back,
+    // along with the slot it was given, so the cache settles at capacity
+    if (this->index.size() > this->capacity) {
+      this->discard(item);
+      if (this->slots.size() > this->capacity) { this->shrink(false); }
+    }
+  }
+
+  void rekey (sqlite3_pcache_page* page, unsigned from, unsigned to) noexcept {
+    if (auto found = this->index.find(to); found != this->index.end()) {
+      this->discard(found->second);
+    }
+    this->index.erase(from);
+    auto item = slot_of(page);
+    item->key = to;
+    this->index.emplace(to, item);
+  }
+
+  void truncate (unsigned limit) noexcept {
+    for (auto item : this->slots) {
+      if (item->live and item->key >= limit) { this->discard(item); }
+    }
+  }
+
+  /* Evicts unpinned pages, as a sweep would, until the rest fit */
+  void resize (size_t pages) noexcept {
+    this->capacity = pages;
+    while (this->index.size() > pages) {
+      auto item = this->sweep();
+      if (not item) { break; }
+      item->next = std::exchange(this->free, item);
+    }
+    if (this->slots.size() > pages) { this->shrink(false); }
+  }
+
+  /* Returns free slots (and unpinned pages when asked) to the shelf */
+  void shrink (bool everything) noexcept {
+    if (everything) {
+      for (auto item : this->slots) {
+        if (item->live and not item->pinned) { this->discard(item); }
+      }
+    }
+    auto& items = shared();
+    std::lock_guard lock { items.mutex };
+    this->surrender(false);
+  }
+
+  int count () const noexcept { return static_cast<int>(this->index.size()); }
+
+private:
+  void discard (slot* item) noexcept {
+    this->index.erase(item->key);
+    item->live = false;
+    item->pinned = false;
+    item->next = std::exchange(this->free, item);
+  }
+
+  slot* obtain (bool required) noexcept {
+    if (this->free) {
+      auto item = this->free;
+      this->free = item->next;
+      return item;
+    }
+    if (not this->purgeable or this->slots.size() < this->capacity) {
+      if (auto item = this->take()) { return item; }
+    }
+    if (auto item = this->sweep()) { return item; }
+    return required ? this->take() : nullptr;
+  }
+
+  /* Second chance: referenced pages are spared once, pinned pages always */
+  slot* sweep () noexcept {
+    if (not this->purgeable or this->slots.empty()) { return nullptr; }
+    auto const size = this->slots.size();
+    this->hand %= size;
+    for (size_t step = 0; step < size * 2; ++step) {
+      auto item = this->slots[this->hand];
+      this->hand = (this->hand + 1) % size;
+      if (not item->live or item->pinned) { continue; }
+      if (std::exchange(item->referenced, false)) { continue; }
+      this->index.erase(item->key);
+      item->live = false;
+      bump(this->stats.evictions);
+      return item;
+    }
+    return nullptr;
+  }
+
+  slot* take () noexcept {
+    auto& items = shared();
+    std::lock_guard lock { items.mutex };
+    auto& source = items.shelves[this->stride];
+    if (not source.head) {
+      auto memory = static_cast<char*>(map_slab());
+      if (not memory) { return nullptr; }
+      items.slabs.fetch_add(1, std::memory_order_relaxed);
+      for (size_t offset = 0; offset + this->stride <= slab_size; offset += this->stride) {
+        auto item = reinterpret_cast<slot*>(memory + offset);
+        item->page.pBuf = memory + offset + header_size;
+        item->page.pExtra = memory + offset + header_size + this->page;
+        item->next = std::exchange(source.head, item);
+      }
+    }
+    auto item = std::exchange(source.head, source.head->next);
+    item->live = false;
+    item->pinned = false;
+    item->referenced = false;
+    try { this->slots.push_back(item); }
+    catch (...) {
+      item->next = std::exchange(source.head, item);
+      return nullptr;
+    }
+    return item;
+  }
+
+  /* Must be called with the registry lock held */
+  void surrender (bool everything) noexcept {
+    auto& target = shared().shelves[this->stride];
+    std::erase_if(this->slots, [&] (slot* item) {
+      if (item->live and not everything) { return false; }
+      item->next = std::exchange(target.head, item);
+      return true;
+    });
+    this->free = nullptr;
+    if (everything) { this->index.clear(); }
+    this->hand = 0;
+  }
+
+  std::unordered_map<unsigned, slot*> index;
+  std::vector<slot*> slots;
+  slot* free { };
+  size_t hand { };
+  size_t capacity { };
+
+  size_t const stride;
+  size_t const page;
+  size_t const extra;
+  bool const purgeable;
+
+  counters stats;
+};
+
+cache* cast (sqlite3_pcache* ptr) noexcept { return reinterpret_cast<cache*>(ptr); }
+
+int page_init (void*) noexcept { return SQLITE_OK; }
+void page_shutdown (void*) noexcept { }
+
+sqlite3_pcache* page_create (int page, int extra, int purgeable) noexcept {
+  auto ptr = new (std::nothrow) cache { page, extra, purgeable != 0 };
+  return reinterpret_cast<sqlite3_pcache*>(ptr);
+}
+
+void page_cachesize (sqlite3_pcache* ptr, int pages) noexcept {
+  ::cast(ptr)->resize(static_cast<size_t>(std::max(pages, 0)));
+}
+
+int page_pagecount (sqlite3_pcache* ptr) noexcept { return ::cast(ptr)->count(); }
+
+sqlite3_pcache_page* page_fetch (sqlite3_pcache* ptr, unsigned key, int create) noexcept {
+  return ::cast(ptr)->fetch(key, create);
+}
+
+void page_unpin (sqlite3_pcache* ptr, sqlite3_pcache_page* page, int discard) noexcept {
+  ::cast(ptr)->unpin(page, discard != 0);
+}
+
+void page_rekey (sqlite3_pcache* ptr, sqlite3_pcache_page* page, unsigned from, unsigned to) noexcept {
+  ::cast(ptr)->rekey(page, from, to);
+}
+
+void page_truncate (sqlite3_pcache* ptr, unsigned limit) noexcept { ::cast(ptr)->truncate(limit); }
+void page_destroy (sqlite3_pcache* ptr) noexcept { delete ::cast(ptr); }
+void page_shrink (sqlite3_pcache* ptr) noexcept { ::cast(ptr)->shrink(true); }
+
+sqlite3_pcache_methods2 const slabbed {
+  1,
+  nullptr,
+  page_init,
+  page_shutdown,
+  page_create,
+  page_cachesize,
+  page_pagecount,
+  page_fetch,
+  page_unpin,
+  page_rekey,
+  page_truncate,
+  page_destroy,
+  page_shrink
+};
+
+std::atomic<bool> installed { false };
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+void install (page_cache kind) noexcept(false) {
+  static sqlite3_pcache_methods2 system = [] {
+    sqlite3_pcache_methods2 methods { };
+    sqlite3_config(SQLITE_CONFIG_GETPCACHE2, &methods);
+    return methods;
+  }();
+  auto const slab = kind == page_cache::slab;
+  auto const& methods = slab ? ::slabbed : system;
+  if (auto result = sqlite3_config(SQLITE_CONFIG_PCACHE2, &methods)) {
+    throw std::system_error(error(result));
+  }
+  installed.store(slab, std::memory_order_relaxed);
+}
+
+page_statistics pages () noexcept {
+  if (not installed.load(std::memory_order_relaxed)) { return { }; }
+  auto& items = shared();
+  std::lock_guard lock { items.mutex };
+  page_statistics result {
+    items.retired.hits.load(std::memory_order_relaxed),
+    items.retired.misses.load(std::memory_order_relaxed),
+    items.retired.evictions.load(std::memory_order_relaxed),
+    items.slabs.load(std::memory_order_relaxed),
+  };
+  for (auto stats : items.caches) {
+    result.hits += stats->hits.load(std::memory_order_relaxed);
+    result.misses += stats->misses.load(std::memory_order_relaxed);
+    result.evictions += stats->evictions.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,162 @@
+#include <apex/sqlite/planner.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <tuple>
+#include <cmath>
+
+namespace {
+
+using apex::sqlite::restraint;
+using apex::sqlite::error;
+using apex::i32;
+using apex::f64;
+
+/* Set in the index number when the lead is walked backwards. The remaining
+ * bits hold the lead plus one, so that zero is a walk in rowid order.
+ */
+constexpr i32 descending = 1 << 30;
+constexpr i32 driver = descending - 1;
+
+/* Fraction of rows kept by the constraints on a single column */
+struct selectivity final {
+  bool equal { false };
+  i32 ranges { };
+  f64 distinct { };
+
+  f64 operator () () const noexcept {
+    if (this->equal) { return this->distinct > 1.0 ? 1.0 / this->distinct : 0.1; }
+    return std::pow(1.0 / 3.0, std::min(this->ranges, 2));
+  }
+};
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+planner::choice::choice (filter const& plan) noexcept(false) :
+  lead { (plan.number() & driver) - 1 },
+  order { static_cast<direction>((plan.number() & descending) != 0) }
+{
+  auto label = plan.label();
+  while (not label.empty()) {
+    i32 column = 0;
+    i32 op = 0;
+    auto const end = label.data() + label.size();
+    auto [colon, cerr] = std::from_chars(label.data(), end, column);
+    if (cerr != std::errc { } or colon == end or *colon != ':') {
+      throw std::system_error(error::inappropriate_operation);
+    }
+    auto [comma, oerr] = std::from_chars(colon + 1, end, op);
+    if (oerr != std::errc { } or comma == end or *comma != ',') {
+      throw std::system_error(error::inappropriate_operation);
+    }
+    label.remove_prefix(static_cast<size_t>(comma + 1 - label.data()));
+    this->terms.push_back(term { column, static_cast<restraint>(op) });
+  }
+}
+
+planner::planner (f64 rows) noexcept :
+  rows { std::max(rows, 1.0) }
+{ }
+
+planner& planner::support (i32 column, capability item) noexcept(false) {
+  this->columns.emplace_back(column, std::move(item));
+  return *this;
+}
+
+ptrdiff_t planner::locate (i32 column) const noexcept {
+  for (size_t idx = 0; idx < this->columns.size(); ++idx) {
+    if (this->columns[idx].first == column) { return static_cast<ptrdiff_t>(idx); }
+  }
+  return -1;
+}
+
+void planner::plan (index::input const& input, index::output& output) const noexcept(false) {
+  auto const& constraints = input.constraints();
+  output = index::output { };
+  output.usages.resize(constraints.size());
+
+  std::vector<::selectivity> kept(this->columns.size());
+  for (size_t idx = 0; idx < this->columns.size(); ++idx) {
+    kept[idx].distinct = this->columns[idx].second.distinct;
+  }
+
+  i32 arguments = 0;
+  bool unique = false;
+  for (size_t idx = 0; idx < constraints.size(); ++idx) {
+    auto const& item = constraints[idx];
+    if (not item.valid()) { continue; }
+    auto const found = this->locate(item.index());
+    if (found < 0) { continue; }
+    auto const& support = this->columns[static_cast<size_t>(found)].second;
+    auto const& allowed = support.restraints;
+    if (std::find(allowed.begin(), allowed.end(), item.type()) == allowed.end()) { continue; }
+    if (support.binary) {
+      auto const collation = input.collation(static_cast<ptrdiff_t>(idx));
+      if (not collation or sqlite3_stricmp(collation, "BINARY")) { continue; }
+    }
+    output.usages[idx] = usage { ++arguments, support.skip };
+    output.label += std::to_string(item.index());
+    output.label += ':';
+    output.label += std::to_string(static_cast<i32>(item.type()));
+    output.label += ',';
+    auto& entry = kept[static_cast<size_t>(found)];
+    if (item.type() == restraint::equal_to) {
+      entry.equal = true;
+      unique = unique or support.distinct >= this->rows;
+    }
+    else { entry.ranges += 1; }
+  }
+
+  auto estimate = this->rows;
+  for (auto const& entry : kept) { estimate *= entry(); }
+  estimate = std::max(estimate, 1.0);
+
+  auto const& orders = input.orders();
+  auto const sorting = estimate * std::log2(estimate + 1.0);
+
+  // Costs a walk led by the column, or in rowid order with -1
+  auto consider = [&] (i32 lead) {
+    auto const found = this->locate(lead);
+    auto const support = found < 0 ? nullptr : std::addressof(this->columns[static_cast<size_t>(found)].second);
+    auto visited = this->rows;
+    auto narrowed = false;
+    if (support and support->seek) {
+      auto const& entry = kept[static_cast<size_t>(found)];
+      narrowed = entry.equal or entry.ranges;
+      visited = std::max(this->rows * entry(), 1.0);
+    }
+    auto cost = visited + (narrowed ? std::log2(this->rows) : 0.0);
+    auto ordered = false;
+    auto order = direction::ascend;
+    if (orders.size() == 1 and orders.front().index() == lead) {
+      order = orders.front().type();
+      ordered = order == direction::ascend or (support and support->reverse);
+    }
+    if (not orders.empty() and not ordered) { cost += sorting; }
+    return std::tuple { cost, ordered, order };
+  };
+
+  auto [cost, ordered, order] = consider(-1);
+  auto lead = -1;
+  for (auto const& [column, support] : this->columns) {
+    if (column < 0 or not support.seek) { continue; }
+    auto [total, sorted, way] = consider(column);
+    if (total >= cost) { continue; }
+    std::tie(cost, ordered, order) = std::tie(total, sorted, way);
+    lead = column;
+  }
+
+  output.number = lead + 1;
+  if (ordered and order == direction::descend) { output.number |= descending; }
+  output.ordered = ordered;
+  output.unique = unique;
+  output.cost = std::max(cost, 1.0);
+  output.rows = static_cast<i64>(estimate);
+}
+
+} /* namespace apex::sqlite */
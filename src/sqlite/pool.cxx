@@ -0,0 +1,92 @@
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/pool.hpp>
+
+namespace {
+
+using apex::sqlite::pool;
+
+template <class Predicate>
+bool wait (std::unique_lock<std::mutex>& lock, std::condition_variable& cv, pool::duration const* timeout, Predicate ready) {
+  if (not timeout) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, *timeout, ready);
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+pool::pool (std::filesystem::path const& path, size_t count) noexcept(false) :
+  primary { path, access::read_write }
+{
+  if (count == 0) { throw std::system_error(error::argument_out_of_range); }
+  // The journal mode is persistent, so the readers opened below will also
+  // see the database in WAL mode.
+  execute(this->primary, "PRAGMA journal_mode=WAL");
+  this->connections.reserve(count);
+  this->idle.reserve(count);
+  for (size_t idx = 0; idx < count; ++idx) {
+    auto& conn = this->connections.emplace_back(path, access::read_only);
+    this->idle.push_back(std::addressof(conn));
+  }
+}
+
+pool::lease pool::reader () noexcept(false) { return this->read(nullptr); }
+pool::lease pool::writer () noexcept(false) { return this->write(nullptr); }
+
+pool::lease pool::reader (duration timeout) noexcept(false) {
+  return this->read(std::addressof(timeout));
+}
+
+pool::lease pool::writer (duration timeout) noexcept(false) {
+  return this->write(std::addressof(timeout));
+}
+
+histogram const& pool::reader_waits () const noexcept { return this->read_waits; }
+histogram const& pool::writer_waits () const noexcept { return this->write_waits; }
+
+size_t pool::readers () const noexcept { return this->connections.size(); }
+
+pool::lease pool::read (duration const* timeout) noexcept(false) {
+  auto const start = std::chrono::steady_clock::now();
+  std::unique_lock lock { this->mutex };
+  auto ready = ::wait(lock, this->readable, timeout, [this] { return not this->idle.empty(); });
+  this->read_waits.record(std::chrono::steady_clock::now() - start);
+  if (not ready) { throw std::system_error(error::resource_busy); }
+  auto conn = this->idle.back();
+  this->idle.pop_back();
+  return lease { conn, recycle { this } };
+}
+
+pool::lease pool::write (duration const* timeout) noexcept(false) {
+  auto const start = std::chrono::steady_clock::now();
+  std::unique_lock lock { this->mutex };
+  auto ready = ::wait(lock, this->writable, timeout, [this] { return not this->writing; });
+  this->write_waits.record(std::chrono::steady_clock::now() - start);
+  if (not ready) { throw std::system_error(error::resource_busy); }
+  this->writing = true;
+  return lease { std::addressof(this->primary), recycle { this } };
+}
+
+void pool::release (connection* conn) noexcept {
+  auto const writer = conn == std::addressof(this->primary);
+  {
+    std::lock_guard lock { this->mutex };
+    if (writer) { this->writing = false; }
+    else { this->idle.push_back(conn); }
+  }
+  if (writer) { this->writable.notify_one(); }
+  else { this->readable.notify_one(); }
+}
+
+void pool::recycle::operator () (connection* conn) const noexcept {
+  this->owner->release(conn);
+}
+
+pool::lease::lease (connection* conn, pool::recycle recycle) noexcept :
+  resource_type { conn, recycle }
+{ }
+
+} /* namespace apex::sqlite */
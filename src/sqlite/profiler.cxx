@@ -0,0 +1,139 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/profiler.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+
+namespace {
+
+using apex::sqlite::profiler;
+using apex::u64;
+
+thread_local profiler::site const* innermost = nullptr;
+
+std::string_view text_of (sqlite3_stmt* stmt) noexcept {
+#if defined(SQLITE_ENABLE_NORMALIZE)
+  if (auto sql = sqlite3_normalized_sql(stmt)) { return sql; }
+#endif /* defined(SQLITE_ENABLE_NORMALIZE) */
+  auto sql = sqlite3_sql(stmt);
+  return sql ? sql : std::string_view { };
+}
+
+void add (std::atomic<u64>& item, u64 value) noexcept {
+  item.fetch_add(value, std::memory_order_relaxed);
+}
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+profiler::site::site (source_location location) noexcept :
+  location { location },
+  previous { std::exchange(innermost, this) }
+{ }
+
+profiler::site::~site () noexcept { innermost = this->previous; }
+
+profiler::site const* profiler::site::current () noexcept { return innermost; }
+
+profiler::profiler (connection& conn, duration threshold, reporter_type reporter) noexcept(false) :
+  traced { conn },
+  reporter { std::move(reporter) },
+  threshold { threshold }
+{
+  auto const mask = SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW;
+  if (auto result = sqlite3_trace_v2(conn.get(), mask, &profiler::trace, this)) {
+    throw std::system_error(error(result));
+  }
+}
+
+profiler::profiler (connection& conn) noexcept(false) :
+  profiler { conn, duration::max(), nullptr }
+{ }
+
+profiler::~profiler () noexcept {
+  sqlite3_trace_v2(this->traced.get(), 0, nullptr, nullptr);
+}
+
+void profiler::visit (function_ref<void(std::string_view, statistics const&)> visitor) const noexcept(false) {
+  std::lock_guard lock { this->mutex };
+  for (auto const& [sql, stats] : this->entries) { visitor(sql, *stats); }
+}
+
+// Entries are never erased, as the connection's thread looks them up without
+// taking the lock.
+void profiler::clear () noexcept {
+  std::lock_guard lock { this->mutex };
+  for (auto const& [sql, stats] : this->entries) {
+    stats->elapsed.clear();
+    stats->calls.store(0, std::memory_order_relaxed);
+    stats->rows.store(0, std::memory_order_relaxed);
+    stats->steps.store(0, std::memory_order_relaxed);
+  }
+}
+
+int profiler::trace (unsigned type, void* data, void* ptr, void* extra) noexcept {
+  auto self = static_cast<profiler*>(data);
+  auto stmt = static_cast<sqlite3_stmt*>(ptr);
+  auto& active = self->active;
+  auto found = std::find_if(active.begin(), active.end(), [stmt] (auto const& item) {
+    return item.stmt == stmt;
+  });
+  switch (type) {
+    case SQLITE_TRACE_STMT: {
+      // Triggers report their subprograms as the statement that fired them,
+      // with a comment naming the trigger in place of the SQL. Treating
+      // that as the start of a new run would restart the outer timing.
+      auto const sql = static_cast<char const*>(extra);
+      if (sql and sql[0] == '-' and sql[1] == '-') { break; }
+      auto const now = std::chrono::steady_clock::now();
+      if (found != active.end()) {
+        *found = running { now, stmt, 0 };
+        break;
+      }
+      try { active.push_back(running { now, stmt, 0 }); }
+      catch (...) { }
+      break;
+    }
+    case SQLITE_TRACE_ROW:
+      if (found != active.end()) { ++found->rows; }
+      break;
+    case SQLITE_TRACE_PROFILE:
+      if (found != active.end()) { self->record(found - active.begin()); }
+      break;
+  }
+  return 0;
+}
+
+void profiler::record (ptrdiff_t index) noexcept {
+  auto const item = this->active[index];
+  this->active[index] = this->active.back();
+  this->active.pop_back();
+  auto const elapsed = duration { std::chrono::steady_clock::now() - item.start };
+  auto const steps = static_cast<u64>(sqlite3_stmt_status(item.stmt, SQLITE_STMTSTATUS_VM_STEP, 1));
+  statistics* stats = nullptr;
+  try { stats = std::addressof(this->lookup(item.stmt)); }
+  catch (...) { return; }
+  stats->elapsed.record(elapsed);
+  ::add(stats->calls, 1);
+  ::add(stats->rows, item.rows);
+  ::add(stats->steps, steps);
+  if (elapsed < this->threshold or not this->reporter) { return; }
+  auto marker = site::current();
+  report info { stats->sql, elapsed, item.rows, steps, marker ? marker->location : source_location { } };
+  try { this->reporter(info); }
+  catch (...) { }
+}
+
+profiler::statistics& profiler::lookup (sqlite3_stmt* stmt) noexcept(false) {
+  auto const sql = ::text_of(stmt);
+  if (auto found = this->entries.find(sql); found != this->entries.end()) { return *found->second; }
+  auto stats = std::make_unique<statistics>();
+  stats->sql = sql;
+  std::lock_guard lock { this->mutex };
+  auto [iter, inserted] = this->entries.emplace(stats->sql, std::move(stats));
+  return *iter->second;
+}
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,38 @@
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/query.hpp>
+#include <sqlite3.h>
+
+namespace {
+
+using apex::sqlite::affinity;
+
+bool accepts (affinity declared, affinity field) noexcept {
+  // BLOB affinity also covers expressions and columns without a type, where
+  // sqlite will happily store anything.
+  if (declared == affinity::blob or declared == field) { return true; }
+  switch (field) {
+    case affinity::integer: return declared == affinity::numeric;
+    case affinity::real: return declared == affinity::numeric or declared == affinity::integer;
+    case affinity::blob: return declared == affinity::text;
+    default: return false;
+  }
+}
+
+} /* nameless namespace */
+
+namespace apex::detail::sqlite {
+
+void expect (statement const& stmt, span<affinity const> fields) noexcept(false) {
+  using ::apex::sqlite::column;
+  using ::apex::sqlite::error;
+  auto const count = static_cast<size_t>(sqlite3_column_count(stmt.get()));
+  if (count != fields.size()) { throw std::system_error(error::argument_type_mismatch); }
+  for (size_t idx = 0; idx < count; ++idx) {
+    column item { stmt.get(), static_cast<ptrdiff_t>(idx) };
+    if (not accepts(item.type(), fields[idx])) {
+      throw std::system_error(error::argument_type_mismatch);
+    }
+  }
+}
+
+} /* namespace apex::detail::sqlite */
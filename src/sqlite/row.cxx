@@ -0,0 +1,94 @@
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/row.hpp>
+#include <sqlite3.h>
+
+namespace apex::sqlite {
+
+row::row (statement const& stmt) noexcept(false) :
+  handle { stmt.get() },
+  count { -1 }
+{ this->advance(1); }
+
+void row::swap (row& that) noexcept {
+  using std::swap;
+  swap(this->handle, that.handle);
+  swap(this->count, that.count);
+}
+
+column row::begin () const { return column { this->get(), 0 }; }
+column row::end () const { return column { this->get(), this->size() }; }
+
+ptrdiff_t row::distance_to (row const& that) const noexcept {
+  return that.count - this->count;
+}
+
+column row::read_from () const noexcept { return this->begin(); }
+
+void row::advance (ptrdiff_t n) noexcept(false) {
+  while (this->handle and n-- > 0) {
+    auto result = sqlite3_step(this->get());
+    if (result == SQLITE_ROW) {
+      ++this->count;
+      continue;
+    }
+    this->handle = nullptr;
+    if (result != SQLITE_DONE) { throw std::system_error(error(result)); }
+  }
+}
+
+bool row::operator == (row const& that) const noexcept { return this->handle == that.handle; }
+bool row::operator != (row const& that) const noexcept { return this->handle != that.handle; }
+
+row::pointer row::get () const noexcept { return this->handle.get(); }
+ptrdiff_t row::size () const noexcept { return sqlite3_data_count(this->get()); }
+
+void fetch (row const& r, ptrdiff_t idx, span<byte const>& out) noexcept {
+  auto const column = static_cast<int>(idx);
+  auto data = static_cast<byte const*>(sqlite3_column_blob(r.get(), column));
+  auto size = static_cast<size_t>(sqlite3_column_bytes(r.get(), column));
+  out = span<byte const> { data, size };
+}
+
+void fetch (row const& r, ptrdiff_t idx, std::string_view& out) noexcept {
+  auto const column = static_cast<int>(idx);
+  auto data = reinterpret_cast<char const*>(sqlite3_column_text(r.get(), column));
+  auto size = static_cast<size_t>(sqlite3_column_bytes(r.get(), column));
+  out = data ? std::string_view { data, size } : std::string_view { };
+}
+
+void fetch (row const& r, ptrdiff_t idx, std::string& out) noexcept(false) {
+  std::string_view text;
+  fetch(r, idx, text);
+  out.assign(text);
+}
+
+void fetch (row const& r, ptrdiff_t idx, f64& out) noexcept {
+  out = sqlite3_column_double(r.get(), static_cast<int>(idx));
+}
+
+void fetch (row const& r, ptrdiff_t idx, f32& out) noexcept {
+  out = static_cast<f32>(sqlite3_column_double(r.get(), static_cast<int>(idx)));
+}
+
+void fetch (row const& r, ptrdiff_t idx, u64& out) noexcept {
+  out = static_cast<u64>(sqlite3_column_int64(r.get(), static_cast<int>(idx)));
+}
+
+void fetch (row const& r, ptrdiff_t idx, u32& out) noexcept {
+  out = static_cast<u32>(sqlite3_column_int64(r.get(), static_cast<int>(idx)));
+}
+
+void fetch (row const& r, ptrdiff_t idx, i64& out) noexcept {
+  out = sqlite3_column_int64(r.get(), static_cast<int>(idx));
+}
+
+void fetch (row const& r, ptrdiff_t idx, i32& out) noexcept {
+  out = sqlite3_column_int(r.get(), static_cast<int>(idx));
+}
+
+void fetch (row const& r, ptrdiff_t idx, bool& out) noexcept {
+  out = sqlite3_column_int(r.get(), static_cast<int>(idx));
+}
+
+} /* namespace apex::sqlite */
@@ -0,0 +1,138 @@
+#include <apex/sqlite/transaction.hpp>
+#include <apex/sqlite/snapshot.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/scan.hpp>
+#include <apex/core/scope.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <exception>
+#include <optional>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <mutex>
+
+namespace {
+
+using apex::detail::sqlite::range;
+using apex::sqlite::statement;
+using apex::i64;
+using apex::u64;
+
+void bind (statement& stmt, char const* name, i64 value) noexcept(false) {
+  auto idx = sqlite3_bind_parameter_index(stmt.get(), name);
+  if (not idx) { throw std::system_error(apex::sqlite::error::argument_out_of_range); }
+  apex::sqlite::bind(stmt, idx, value);
+}
+
+} /* nameless namespace */
+
+namespace apex::detail::sqlite {
+
+using ::apex::sqlite::transaction;
+using ::apex::sqlite::snapshot;
+using ::apex::sqlite::behavior;
+using ::apex::sqlite::error;
+
+std::vector<range> partition (connection& conn, std::string_view table, size_t parts) noexcept(false) {
+  // min() and max() of the rowid are a single b-tree descent each
+  std::string name { table };
+  auto text = sqlite3_mprintf(R"(SELECT min(rowid), max(rowid) FROM "%w")", name.c_str());
+  if (not text) { throw std::system_error(error::not_enough_memory); }
+  scope_exit free { [=] { sqlite3_free(text); } };
+  auto stmt = conn.prepare(text);
+  if (sqlite3_step(stmt->get()) != SQLITE_ROW or sqlite3_column_type(stmt->get(), 0) == SQLITE_NULL) {
+    return { };
+  }
+  auto const first = sqlite3_column_int64(stmt->get(), 0);
+  auto const last = sqlite3_column_int64(stmt->get(), 1);
+  if (parts <= 1) { return { range { first, last } }; }
+  // Unsigned, so the full i64 range does not overflow
+  auto const span = static_cast<u64>(last) - static_cast<u64>(first);
+  auto const width = span / parts + 1;
+  std::vector<range> ranges;
+  ranges.reserve(parts);
+  for (auto start = first; ; ) {
+    auto const remaining = static_cast<u64>(last) - static_cast<u64>(start);
+    auto const stop = remaining < width ? last : static_cast<i64>(static_cast<u64>(start) + width - 1);
+    ranges.push_back(range { start, stop });
+    if (stop == last) { break; }
+    start = stop + 1;
+  }
+  return ranges;
+}
+
+cache::lease prepare (connection& conn, std::string_view sql, range span) noexcept(false) {
+  auto stmt = conn.prepare(sql);
+  if (not stmt->is_readonly() or not stmt.tail().empty()) {
+    throw std::system_error(error::inappropriate_operation);
+  }
+  ::bind(*stmt, ":first", span.first);
+  ::bind(*stmt, ":last", span.last);
+  return stmt;
+}
+
+void scan (
+  pool& readers,
+  std::string_view table,
+  size_t parts,
+  function_ref<void(size_t)> reserve,
+  function_ref<void(connection&, range, size_t)> each) noexcept(false)
+{
+  auto lead = readers.reader();
+  transaction hold { *lead, behavior::deferred };
+  snapshot const point { *lead };
+  auto const ranges = partition(*lead, table, parts ? parts : readers.readers());
+  reserve(ranges.size());
+
+  std::atomic<size_t> next { 0 };
+  std::atomic<bool> failed { false };
+  std::exception_ptr problem;
+  std::mutex mutex;
+  auto fail = [&] {
+    std::lock_guard lock { mutex };
+    if (not problem) { problem = std::current_exception(); }
+    failed.store(true, std::memory_order_relaxed);
+  };
+  auto work = [&] (connection& conn) {
+    try {
+      for (auto idx = next++; idx < ranges.size() and not failed.load(std::memory_order_relaxed); idx = next++) {
+        each(conn, ranges[idx], idx);
+      }
+    } catch (...) { fail(); }
+  };
+
+  // Helpers only get a connection if one is free right now. Waiting for one
+  // could deadlock, as the caller may already hold every other lease (and
+  // the lead's range is covered by the calling thread either way).
+  std::vector<pool::lease> leases;
+  auto const helpers = std::min(readers.readers(), ranges.size());
+  leases.reserve(helpers);
+  for (size_t idx = 1; idx < helpers; ++idx) {
+    try { leases.push_back(readers.reader(pool::duration::zero())); }
+    catch (std::system_error const& e) {
+      if (e.code() != error::resource_busy) { throw; }
+      break;
+    }
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(leases.size());
+  try {
+    // The calling thread takes a share of the ranges as well
+    for (auto& item : leases) {
+      threads.emplace_back([&, conn = item.get()] {
+        try {
+          transaction txn { *conn, point };
+          work(*conn);
+        } catch (...) { fail(); }
+      });
+    }
+  } catch (...) { fail(); }
+  work(*lead);
+  for (auto& thread : threads) { thread.join(); }
+  if (problem) { std::rethrow_exception(problem); }
+}
+
+} /* namespace apex::detail::sqlite */
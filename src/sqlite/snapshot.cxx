@@ -0,0 +1,40 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/snapshot.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+namespace apex::sqlite {
+
+snapshot::snapshot (connection& conn, zstring_view schema) noexcept(false) :
+  resource_type { },
+  name { schema.data(), schema.size() }
+{
+  if (sqlite3_get_autocommit(conn.get())) { throw std::system_error(error::inappropriate_operation); }
+  // A BEGIN on its own does not start reading, so make sure we have
+  execute(conn, "SELECT count(*) FROM sqlite_master");
+  sqlite3_snapshot* ptr = nullptr;
+  if (auto result = sqlite3_snapshot_get(conn.get(), this->name.c_str(), &ptr)) {
+    throw std::system_error(error(result));
+  }
+  this->storage.reset(ptr, sqlite3_snapshot_free);
+}
+
+snapshot::snapshot (connection& conn) noexcept(false) :
+  snapshot { conn, "main" }
+{ }
+
+std::string const& snapshot::schema () const noexcept { return this->name; }
+
+bool snapshot::operator == (snapshot const& that) const noexcept {
+  return sqlite3_snapshot_cmp(this->get(), that.get()) == 0;
+}
+
+bool snapshot::operator != (snapshot const& that) const noexcept {
+  return not (*this == that);
+}
+
+bool snapshot::operator < (snapshot const& that) const noexcept {
+  return sqlite3_snapshot_cmp(this->get(), that.get()) < 0;
+}
+
+} /* namespace apex::sqlite */
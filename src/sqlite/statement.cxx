@@ -1,15 +1,132 @@
+#include <apex/sqlite/connection.hpp>
 #include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/value.hpp>
+#include <apex/memory/out.hpp>
 #include <sqlite3.h>
 
+namespace {
+
+void check (int result) noexcept(false) {
+  if (result) { throw std::system_error(apex::sqlite::error(result)); }
+}
+
+std::string_view trim (std::string_view text) noexcept {
+  auto const start = text.find_first_not_of(" \t\n\v\f\r");
+  if (start == text.npos) { return { }; }
+  return text.substr(start);
+}
+
+} /* nameless namespace */
+
 namespace apex::sqlite {
 
-statement::statement () :
-  handle { nullptr, sqlite3_finalize }
-{ }
+void default_delete<sqlite3_stmt>::operator () (sqlite3_stmt* ptr) noexcept {
+  sqlite3_finalize(ptr);
+}
+
+statement::statement (connection& conn, std::string_view& sql) noexcept(false) :
+  resource_type { },
+  bounds { conn.current.get() }
+{
+  sql = ::trim(sql);
+  if (sql.empty()) { return; }
+  char const* tail = nullptr;
+  auto const size = static_cast<int>(sql.size());
+  auto result = sqlite3_prepare_v3(
+    conn.get(),
+    sql.data(),
+    size,
+    SQLITE_PREPARE_PERSISTENT,
+    out_ptr(this->storage),
+    &tail);
+  if (result) { throw std::system_error(error(result)); }
+  sql = ::trim(sql.substr(static_cast<size_t>(tail - sql.data())));
+}
+
+statement::iterator statement::begin () const noexcept(false) { return iterator { *this }; }
+statement::iterator statement::end () const noexcept { return iterator { }; }
 
-statement::pointer statement::get () const noexcept { return this->handle.get(); }
+std::string_view statement::sql () const noexcept {
+  if (auto text = sqlite3_sql(this->get())) { return text; }
+  return { };
+}
 
 bool statement::is_readonly () const noexcept { return sqlite3_stmt_readonly(this->get()); }
 bool statement::is_busy () const noexcept { return sqlite3_stmt_busy(this->get()); }
 
+void statement::execute () noexcept(false) {
+  if (not *this) { return; }
+  int result = SQLITE_ROW;
+  while (result == SQLITE_ROW) { result = sqlite3_step(this->get()); }
+  this->reset();
+  if (result != SQLITE_DONE) { throw std::system_error(error(result)); }
+}
+
+// The progress handler belongs to the connection, so the deadline is only
+// in scope for as long as this statement is being stepped. Any scope this
+// runs in is restored (and still applies) meanwhile.
+void statement::execute (deadline const& limit) noexcept(false) {
+  if (not *this) { return; }
+  deadline::scope bound { *this, limit };
+  this->execute();
+}
+
+void statement::execute (deadline::clock::time_point until) noexcept(false) {
+  this->execute(deadline { until });
+}
+
+void statement::execute (std::stop_token token) noexcept(false) {
+  this->execute(deadline { std::move(token) });
+}
+
+void statement::reset () noexcept { sqlite3_reset(this->get()); }
+void statement::clear () noexcept { sqlite3_clear_bindings(this->get()); }
+
+ptrdiff_t statement::index (char const* name) noexcept(false) {
+  auto idx = sqlite3_bind_parameter_index(this->get(), name);
+  if (not idx) { throw std::system_error(error::argument_out_of_range); }
+  return idx;
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, span<byte const> blob) noexcept(false) {
+  auto const size = static_cast<sqlite3_uint64>(blob.size());
+  ::check(sqlite3_bind_blob64(stmt.get(), static_cast<int>(idx), blob.data(), size, SQLITE_TRANSIENT));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, std::string_view text) noexcept(false) {
+  auto const size = static_cast<sqlite3_uint64>(text.size());
+  ::check(sqlite3_bind_text64(stmt.get(), static_cast<int>(idx), text.data(), size, SQLITE_TRANSIENT, SQLITE_UTF8));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, value const& item) noexcept(false) {
+  ::check(sqlite3_bind_value(stmt.get(), static_cast<int>(idx), item.get()));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, nullptr_t) noexcept(false) {
+  ::check(sqlite3_bind_null(stmt.get(), static_cast<int>(idx)));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, f64 number) noexcept(false) {
+  ::check(sqlite3_bind_double(stmt.get(), static_cast<int>(idx), number));
+}
+
+// sqlite has no unsigned integers, so large values wrap around (as they do in
+// any other sqlite binding library)
+void bind (statement const& stmt, ptrdiff_t idx, u64 number) noexcept(false) {
+  bind(stmt, idx, static_cast<i64>(number));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, u32 number) noexcept(false) {
+  bind(stmt, idx, static_cast<i64>(number));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, i64 number) noexcept(false) {
+  ::check(sqlite3_bind_int64(stmt.get(), static_cast<int>(idx), number));
+}
+
+void bind (statement const& stmt, ptrdiff_t idx, i32 number) noexcept(false) {
+  ::check(sqlite3_bind_int(stmt.get(), static_cast<int>(idx), number));
+}
+
 } /* namespace apex::sqlite */
@@ -0,0 +1,333 @@
+#include <apex/sqlite/context.hpp>
+#include <apex/sqlite/value.hpp>
+#include <apex/sqlite/table.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/memory.hpp>
+#include <apex/core/memory.hpp>
+#include <sqlite3.h>
+
+#include <exception>
+#include <new>
+
+namespace {
+
+using apex::sqlite::context;
+using apex::sqlite::cursor;
+using apex::sqlite::table;
+using apex::sqlite::value;
+using apex::span;
+
+struct vtab final : sqlite3_vtab {
+  std::shared_ptr<table> self;
+};
+
+struct vcursor final : sqlite3_vtab_cursor {
+  std::shared_ptr<cursor> self;
+};
+
+template <class T>
+T* make () noexcept(false) {
+  auto ptr = apex::sqlite::allocate(sizeof(T));
+  if (not ptr) { throw std::system_error(apex::sqlite::error::not_enough_memory); }
+  return ::new (ptr) T { };
+}
+
+template <class T>
+void dispose (T* ptr) noexcept {
+  apex::destroy_at(ptr);
+  apex::sqlite::deallocate(ptr);
+}
+
+// Turns the exception currently being handled into an sqlite result code,
+// along with a message for sqlite to report, which it takes ownership of.
+int fail (char** message) noexcept {
+  auto code = SQLITE_ERROR;
+  char const* what = "unknown error";
+  try { throw; }
+  catch (std::system_error const& e) {
+    if (e.code().category() == apex::sqlite::category()) { code = e.code().value(); }
+    what = e.what();
+  }
+  catch (std::bad_alloc const&) { return SQLITE_NOMEM; }
+  catch (std::exception const& e) { what = e.what(); }
+  catch (...) { }
+  if (message) {
+    sqlite3_free(*message);
+    *message = sqlite3_mprintf("%s", what);
+  }
+  return code;
+}
+
+int fail (sqlite3_vtab* tab) noexcept { return ::fail(&tab->zErrMsg); }
+
+table& self (sqlite3_vtab* tab) noexcept { return *static_cast<vtab*>(tab)->self; }
+cursor& self (sqlite3_vtab_cursor* cur) noexcept { return *static_cast<vcursor*>(cur)->self; }
+
+template <bool Create>
+int initialize (sqlite3* db, void* aux, int argc, char const* const* argv, sqlite3_vtab** out, char** error) noexcept {
+  try {
+    auto& prototype = *static_cast<std::shared_ptr<table>*>(aux);
+    auto item = prototype->clone();
+    item->plugin(argv[0]);
+    item->database(argv[1]);
+    item->name(argv[2]);
+    auto arguments = span<char const* const> { argv + 3, static_cast<size_t>(argc - 3) };
+    if constexpr (Create) { item->create(arguments); }
+    else { item->connect(arguments); }
+    auto const schema = item->schema();
+    if (auto result = sqlite3_declare_vtab(db, schema.c_str())) {
+      throw std::system_error(apex::sqlite::error(result));
+    }
+    auto tab = ::make<vtab>();
+    tab->self = std::move(item);
+    *out = tab;
+    return SQLITE_OK;
+  } catch (...) { return ::fail(error); }
+}
+
+int plan (sqlite3_vtab* tab, sqlite3_index_info* info) noexcept {
+  try {
+    apex::sqlite::index::input const input { info };
+    auto const& output = ::self(tab).access(input);
+    for (auto idx = 0; idx < info->nConstraint; ++idx) {
+      if (static_cast<size_t>(idx) >= output.usages.size()) { break; }
+      auto const& usage = output.usages[static_cast<size_t>(idx)];
+      info->aConstraintUsage[idx].argvIndex = usage.argument;
+      info->aConstraintUsage[idx].omit = usage.skip == apex::sqlite::omit::yes;
+    }
+    info->idxNum = output.number;
+    if (not output.label.empty()) {
+      info->idxStr = sqlite3_mprintf("%s", output.label.c_str());
+      if (not info->idxStr) { return SQLITE_NOMEM; }
+      info->needToFreeIdxStr = true;
+    }
+    info->orderByConsumed = output.ordered;
+    info->estimatedCost = output.cost;
+    info->estimatedRows = output.rows;
+    if (output.unique) { info->idxFlags |= SQLITE_INDEX_SCAN_UNIQUE; }
+    return SQLITE_OK;
+  } catch (...) { return ::fail(tab); }
+}
+
+// sqlite keeps the table around when xDestroy fails, as the DROP TABLE fails
+// with it. It never calls xDisconnect a second time, so the table must be
+// released even when disconnect throws, and there is no one left to read a
+// message.
+template <bool Destroy>
+int finalize (sqlite3_vtab* tab) noexcept {
+  auto result = SQLITE_OK;
+  try {
+    if constexpr (Destroy) { ::self(tab).destroy(); }
+    else { ::self(tab).disconnect(); }
+  } catch (...) {
+    if constexpr (Destroy) { return ::fail(tab); }
+    else { result = ::fail(static_cast<char**>(nullptr)); }
+  }
+  ::dispose(static_cast<vtab*>(tab));
+  return result;
+}
+
+int open_cursor (sqlite3_vtab* tab, sqlite3_vtab_cursor** out) noexcept {
+  try {
+    auto iterator = ::self(tab).iterator();
+    auto cur = ::make<vcursor>();
+    cur->self = std::move(iterator);
+    *out = cur;
+    return SQLITE_OK;
+  } catch (...) { return ::fail(tab); }
+}
+
+int close_cursor (sqlite3_vtab_cursor* cur) noexcept {
+  ::dispose(static_cast<vcursor*>(cur));
+  return SQLITE_OK;
+}
+
+int filter (sqlite3_vtab_cursor* cur, int number, char const* label, int argc, sqlite3_value** argv) noexcept {
+  try {
+    std::vector<value> values;
+    values.reserve(static_cast<size_t>(argc));
+    for (auto idx = 0; idx < argc; ++idx) { values.emplace_back(argv[idx]); }
+    apex::sqlite::filter const plan { number, label };
+    ::self(cur).filter(plan, span<value const> { values.data(), values.size() });
+    return SQLITE_OK;
+  } catch (...) { return ::fail(cur->pVtab); }
+}
+
+int next (sqlite3_vtab_cursor* cur) noexcept {
+  try {
+    ::self(cur).next();
+    return SQLITE_OK;
+  } catch (...) { return ::fail(cur->pVtab); }
+}
+
+int eof (sqlite3_vtab_cursor* cur) noexcept { return ::self(cur).ended(); }
+
+int column (sqlite3_vtab_cursor* cur, sqlite3_context* ptr, int idx) noexcept {
+  try {
+    context ctx { ptr };
+    ::self(cur).column(ctx, idx);
+    return SQLITE_OK;
+  } catch (...) { return ::fail(cur->pVtab); }
+}
+
+int rowid (sqlite3_vtab_cursor* cur, sqlite3_int64* out) noexcept {
+  *out = ::self(cur).row();
+  return SQLITE_OK;
+}
+
+void invoke (sqlite3_context* ptr, int argc, sqlite3_value** argv) noexcept {
+  context ctx { ptr, argc, argv };
+  try { (*static_cast<table::function_type*>(ctx.user()))(ctx); }
+  catch (...) {
+    char* message = nullptr;
+    auto code = ::fail(&message);
+    sqlite3_result_error(ptr, message ? message : "", -1);
+    sqlite3_result_error_code(ptr, code);
+    sqlite3_free(message);
+  }
+}
+
+using function_pointer = void (*)(sqlite3_context*, int, sqlite3_value**);
+
+int find (sqlite3_vtab* tab, int argc, char const* name, function_pointer* function, void** arg) noexcept {
+  try {
+    auto found = ::self(tab).find(name, argc);
+    if (not found) { return 0; }
+    *arg = ::self(tab).save(std::move(found));
+    *function = ::invoke;
+    return 1;
+  } catch (...) {
+    ::fail(tab);
+    return 0;
+  }
+}
+
+int rename_table (sqlite3_vtab* tab, char const* name) noexcept {
+  try {
+    ::self(tab).rename(name);
+    ::self(tab).name(name);
+    return SQLITE_OK;
+  } catch (...) { return ::fail(tab); }
+}
+
+sqlite3_module readonly {
+  1,
+  ::initialize<true>,
+  ::initialize<false>,
+  ::plan,
+  ::finalize<false>,
+  ::finalize<true>,
+  ::open_cursor,
+  ::close_cursor,
+  ::filter,
+  ::next,
+  ::eof,
+  ::column,
+  ::rowid,
+  nullptr, /* xUpdate */
+  nullptr, /* xBegin */
+  nullptr, /* xSync */
+  nullptr, /* xCommit */
+  nullptr, /* xRollback */
+  ::find,
+  ::rename_table,
+  nullptr, /* xSavepoint */
+  nullptr, /* xRelease */
+  nullptr, /* xRollbackTo */
+  nullptr, /* xShadowName */
+};
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+constraint::constraint (u8 op, bool usable, i32 idx) noexcept :
+  op { static_cast<restraint>(op) },
+  usable { usable },
+  idx { idx }
+{ }
+
+void constraint::swap (constraint& that) noexcept {
+  using std::swap;
+  swap(this->op, that.op);
+  swap(this->usable, that.usable);
+  swap(this->idx, that.idx);
+}
+
+restraint constraint::type () const noexcept { return this->op; }
+bool constraint::valid () const noexcept { return this->usable; }
+i32 constraint::index () const noexcept { return this->idx; }
+
+order::order (u8 desc, i32 idx) noexcept :
+  dir { static_cast<direction>(desc != 0) },
+  idx { idx }
+{ }
+
+void order::swap (order& that) noexcept {
+  using std::swap;
+  swap(this->dir, that.dir);
+  swap(this->idx, that.idx);
+}
+
+direction order::type () const noexcept { return this->dir; }
+i32 order::index () const noexcept { return this->idx; }
+
+index::input::input (sqlite3_index_info* info) noexcept(false) :
+  info { info }
+{
+  this->restraints.reserve(static_cast<size_t>(info->nConstraint));
+  for (auto idx = 0; idx < info->nConstraint; ++idx) {
+    auto const& item = info->aConstraint[idx];
+    this->restraints.emplace_back(item.op, item.usable, item.iColumn);
+  }
+  this->ordering.reserve(static_cast<size_t>(info->nOrderBy));
+  for (auto idx = 0; idx < info->nOrderBy; ++idx) {
+    auto const& item = info->aOrderBy[idx];
+    this->ordering.emplace_back(item.desc, item.iColumn);
+  }
+}
+
+std::vector<constraint> const& index::input::constraints () const noexcept { return this->restraints; }
+std::vector<order> const& index::input::orders () const noexcept { return this->ordering; }
+
+char const* index::input::collation (ptrdiff_t idx) const noexcept {
+  return sqlite3_vtab_collation(this->get(), static_cast<int>(idx));
+}
+
+u64 index::input::columns () const noexcept { return this->get()->colUsed; }
+sqlite3_index_info* index::input::get () const noexcept { return this->info.get(); }
+
+filter::filter (i32 num, char const* text) noexcept :
+  text { text },
+  num { num }
+{ }
+
+std::string_view filter::label () const noexcept {
+  if (not this->text) { return { }; }
+  return this->text;
+}
+
+i32 filter::number () const noexcept { return this->num; }
+
+table::function_type table::find (char const*, i32) noexcept(false) { return nullptr; }
+
+char const* table::database () noexcept { return this->db.c_str(); }
+char const* table::plugin () noexcept { return this->mod.c_str(); }
+char const* table::name () noexcept { return this->labels.c_str(); }
+
+void table::database (char const* text) noexcept(false) { this->db = text; }
+void table::plugin (char const* text) noexcept(false) { this->mod = text; }
+void table::name (char const* text) noexcept(false) { this->labels = text; }
+
+table::function_type* table::save (function_type&& function) noexcept(false) {
+  return std::addressof(this->functions.emplace_back(std::move(function)));
+}
+
+// TODO: hand out modules with xUpdate (and transactions) for mutator and its
+// children
+sqlite3_module* table::module () const noexcept { return std::addressof(::readonly); }
+
+conflict mutator::policy () const noexcept { return this->pol; }
+void mutator::policy (conflict pol) noexcept { this->pol = pol; }
+
+} /* namespace apex::sqlite */
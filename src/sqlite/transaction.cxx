@@ -1,6 +1,8 @@
 #include <apex/sqlite/transaction.hpp>
 #include <apex/sqlite/connection.hpp>
 #include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/snapshot.hpp>
+#include <apex/sqlite/error.hpp>
 
 #include <apex/core/memory.hpp>
 #include <apex/core/scope.hpp>
@@ -8,6 +10,8 @@
 
 #include <sqlite3.h>
 
+#include <utility>
+
 namespace {
 
 using apex::sqlite::behavior;
@@ -26,17 +30,55 @@ auto mode (behavior b) noexcept {
 
 namespace apex::sqlite {
 
-transaction::transaction (connection& handle, behavior b) noexcept :
+transaction::transaction (connection& handle, behavior b) noexcept(false) :
   handle { handle },
-  commit { true }
-{ execute(this->handle, ::mode(b)); }
+  open { false }
+{
+  execute(this->handle, ::mode(b));
+  this->open = true;
+}
 
-transaction::~transaction () noexcept {
-  auto text = this->commit ? "COMMIT" : "ROLLBACK";
-  execute(this->handle, text);
+transaction::transaction (connection& handle, snapshot const& point) noexcept(false) :
+  handle { handle },
+  open { false }
+{
+  auto const schema = point.schema().c_str();
+  execute(this->handle, "BEGIN DEFERRED");
+  this->open = true;
+  // The destructor does not run for a constructor that throws
+  try {
+    auto result = sqlite3_snapshot_open(this->handle.get(), schema, point.get());
+    if (result == SQLITE_ERROR) {
+      // A connection that has never read the database has not opened its WAL
+      // yet, which sqlite reports as a generic error. Read once, and retry.
+      execute(this->handle, "ROLLBACK");
+      this->open = false;
+      execute(this->handle, "SELECT count(*) FROM sqlite_master");
+      execute(this->handle, "BEGIN DEFERRED");
+      this->open = true;
+      result = sqlite3_snapshot_open(this->handle.get(), schema, point.get());
+    }
+    if (result) { throw std::system_error(error(result)); }
+  } catch (...) {
+    this->rollback();
+    throw;
+  }
 }
 
-void transaction::release () noexcept { this->commit = false; }
+transaction::~transaction () noexcept { this->rollback(); }
+
+// If the COMMIT itself fails, sqlite may or may not have rolled back already,
+// which the destructor takes care of.
+void transaction::commit () noexcept(false) {
+  execute(this->handle, "COMMIT");
+  this->open = false;
+}
+
+void transaction::rollback () noexcept {
+  if (not std::exchange(this->open, false) or this->handle.autocommit()) { return; }
+  try { execute(this->handle, "ROLLBACK"); }
+  catch (...) { }
+}
 
 savepoint::savepoint (connection& handle, std::string_view name) noexcept :
   handle { handle },
@@ -53,7 +95,7 @@ savepoint::savepoint (connection& handle, std::string_view name) noexcept :
 
 savepoint::~savepoint () noexcept {
   static constexpr auto rollback = R"(ROLLBACK TRANSACTION TO SAVEPOINT %.*Q)";
-  static constexpr auto release = R"(RELEASE SAVEPOINT %.Q)";
+  static constexpr auto release = R"(RELEASE SAVEPOINT %.*Q)";
   auto const fmt = this->commit ? release : rollback;
   auto const size = static_cast<int>(this->name.size());
   auto const data = this->name.data();
@@ -8,6 +8,19 @@ void value::swap (value& that) noexcept {
   swap(this->handle, that.handle);
 }
 
+value::value (pointer ptr) noexcept :
+  handle { ptr }
+{ }
+
+value::pointer value::get () const noexcept { return this->handle.get(); }
+
+value::operator std::string_view () const noexcept {
+  auto data = reinterpret_cast<char const*>(sqlite3_value_text(this->get()));
+  auto length = static_cast<size_t>(sqlite3_value_bytes(this->get()));
+  if (not data) { return { }; }
+  return std::string_view { data, length };
+}
+
 value::operator span<byte const> () const noexcept {
   auto length = static_cast<size_t>(sqlite3_value_bytes(this->get()));
   auto data = reinterpret_cast<byte const*>(sqlite3_value_blob(this->get()));
@@ -0,0 +1,782 @@
+#include <apex/sqlite/vfs.hpp>
+#include <apex/sqlite/error.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <chrono>
+#include <deque>
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+
+#if __has_include(<linux/io_uring.h>)
+  #include <linux/io_uring.h>
+  #include <sys/syscall.h>
+  #include <sys/mman.h>
+  #define APEX_SQLITE_URING 1
+#endif /* __has_include(<linux/io_uring.h>) */
+
+namespace {
+
+using apex::sqlite::vfs;
+using apex::byte;
+using apex::i64;
+using apex::u64;
+
+using clock_type = std::chrono::steady_clock;
+
+void add (std::atomic<u64>& item, u64 value) noexcept {
+  item.fetch_add(value, std::memory_order_relaxed);
+}
+
+/* What a completion is for, kept in the low byte of its user data */
+enum class kind : u64 { write, sync, window };
+
+u64 tag (kind type, size_t idx) noexcept { return static_cast<u64>(type) | (static_cast<u64>(idx) << 8); }
+
+#if defined(APEX_SQLITE_URING)
+
+/* A bare io_uring instance. Only ever used by one thread at a time */
+struct ring final {
+  explicit ring (unsigned entries) noexcept {
+    io_uring_params params { };
+    auto const fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) { return; }
+    this->fd = fd;
+    this->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    auto const single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) { this->sq_size = this->cq_size = std::max(this->sq_size, this->cq_size); }
+    auto map = [fd] (size_t size, off_t offset) noexcept {
+      return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    };
+    this->sq_map = map(this->sq_size, IORING_OFF_SQ_RING);
+    if (this->sq_map == MAP_FAILED) { this->release(); return; }
+    this->cq_map = single ? this->sq_map : map(this->cq_size, IORING_OFF_CQ_RING);
+    if (this->cq_map == MAP_FAILED) { this->release(); return; }
+    this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    auto sqes = map(this->sqes_size, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) { this->release(); return; }
+    this->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    auto sq = static_cast<char*>(this->sq_map);
+    auto cq = static_cast<char*>(this->cq_map);
+    this->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    this->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    this->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    this->sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    this->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    this->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    this->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    this->cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    this->entries = params.sq_entries;
+    this->tail = *this->sq_tail;
+  }
+
+  ring (ring const&) = delete;
+  ~ring () noexcept { this->release(); }
+
+  bool valid () const noexcept { return this->sqes; }
+
+  /* Returns nullptr once `entries` operations are in flight */
+  io_uring_sqe* next () noexcept {
+    if (this->inflight >= this->entries) { return nullptr; }
+    auto const idx = this->tail & this->sq_mask;
+    auto sqe = this->sqes + idx;
+    std::memset(sqe, 0, sizeof(*sqe));
+    this->sq_array[idx] = idx;
+    ++this->tail;
+    ++this->queued;
+    ++this->inflight;
+    return sqe;
+  }
+
+  /* Submits whatever is queued, and waits for at least `wait` completions */
+  int enter (unsigned wait) noexcept {
+    __atomic_store_n(this->sq_tail, this->tail, __ATOMIC_RELEASE);
+    auto const flags = wait ? IORING_ENTER_GETEVENTS : 0u;
+    auto const result = ::syscall(__NR_io_uring_enter, this->fd, this->queued, wait, flags, nullptr, 0);
+    if (result < 0) { return errno == EINTR ? 0 : -errno; }
+    this->queued -= static_cast<unsigned>(result);
+    return 0;
+  }
+
+  template <class F>
+  void reap (F&& each) noexcept {
+    auto head = *this->cq_head;
+    auto const tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      auto const& cqe = this->cqes[head & this->cq_mask];
+      --this->inflight;
+      each(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  void release () noexcept {
+    if (this->sqes) { ::munmap(this->sqes, this->sqes_size); }
+    if (this->cq_map != MAP_FAILED and this->cq_map != this->sq_map) { ::munmap(this->cq_map, this->cq_size); }
+    if (this->sq_map != MAP_FAILED) { ::munmap(this->sq_map, this->sq_size); }
+    if (this->fd >= 0) { ::close(this->fd); }
+    this->sqes = nullptr;
+    this->sq_map = this->cq_map = MAP_FAILED;
+    this->fd = -1;
+  }
+
+  void* sq_map { MAP_FAILED };
+  void* cq_map { MAP_FAILED };
+  size_t sq_size { };
+  size_t cq_size { };
+  size_t sqes_size { };
+  io_uring_sqe* sqes { };
+  io_uring_cqe* cqes { };
+  unsigned* sq_head { };
+  unsigned* sq_tail { };
+  unsigned* sq_array { };
+  unsigned* cq_head { };
+  unsigned* cq_tail { };
+  unsigned sq_mask { };
+  unsigned cq_mask { };
+  unsigned entries { };
+  unsigned tail { };
+  unsigned queued { };
+  unsigned inflight { };
+  int fd { -1 };
+};
+
+#else
+
+struct ring final {
+  explicit ring (unsigned) noexcept { }
+  bool valid () const noexcept { return false; }
+};
+
+#endif /* defined(APEX_SQLITE_URING) */
+
+bool available () noexcept {
+  static bool const result = ring { 1 }.valid();
+  return result;
+}
+
+// The unix VFS keeps a file's descriptor right after these. Descriptors
+// read from here are only trusted once they are known to refer to the file
+// that was opened.
+struct unix_file final {
+  sqlite3_io_methods const* methods;
+  sqlite3_vfs* vfs;
+  void* inode;
+  int fd;
+};
+
+int descriptor (sqlite3_vfs const* base, sqlite3_file const* file, char const* name) noexcept {
+  if (not name or std::strncmp(base->zName, "unix", 4)) { return -1; }
+  auto const fd = reinterpret_cast<unix_file const*>(file)->fd;
+  struct stat opened { };
+  struct stat named { };
+  if (fd < 0 or ::fstat(fd, &opened) or ::stat(name, &named)) { return -1; }
+  if (not S_ISREG(opened.st_mode)) { return -1; }
+  if (opened.st_dev != named.st_dev or opened.st_ino != named.st_ino) { return -1; }
+  return fd;
+}
+
+/* A readahead buffer, covering [offset, offset + length) once ready */
+struct window final {
+  std::vector<byte> data;
+  iovec vector { };
+  i64 offset { };
+  size_t length { };
+  bool pending { false };
+  bool ready { false };
+
+  bool covers (i64 first, i64 last) const noexcept {
+    return this->ready and this->offset <= first and last <= this->offset + static_cast<i64>(this->length);
+  }
+};
+
+struct pending final {
+  std::vector<byte> data;
+  iovec vector { };
+  i64 offset;
+};
+
+// Reads until the buffer is full, or the end of the file. Returns the number
+// of bytes read, or -1.
+ssize_t fill (int fd, byte* data, size_t size, i64 offset) noexcept {
+  size_t done = 0;
+  while (done < size) {
+    auto const result = ::pread(fd, data + done, size - done, static_cast<off_t>(offset) + static_cast<off_t>(done));
+    if (result < 0 and errno == EINTR) { continue; }
+    if (result < 0) { return -1; }
+    if (result == 0) { break; }
+    done += static_cast<size_t>(result);
+  }
+  return static_cast<ssize_t>(done);
+}
+
+int code (int error, int fallback) noexcept {
+  return error == ENOSPC ? SQLITE_FULL : fallback;
+}
+
+/** @brief The part of a file that bypasses the unix VFS.
+ *
+ * Only used for files whose descriptor is known, and never for WAL files.
+ */
+struct stream final {
+  stream (int fd, size_t depth, size_t size, bool database, bool accelerated) noexcept(false) :
+    uring { accelerated ? static_cast<unsigned>(depth) : 0u },
+    fd { fd },
+    size { size },
+    database { database }
+  {
+    for (auto& item : this->windows) { item.data.resize(size); }
+  }
+
+  // Only the database's writes are queued. Journal writes must reach the
+  // kernel before the database writes that follow them, even when they are
+  // never synced, or a crash could leave the database without its journal.
+  bool deferred () const noexcept { return this->database and this->uring.valid(); }
+
+  int read (void* out, int amount, i64 offset, vfs::statistics& stats) noexcept {
+    auto const first = offset;
+    auto const last = offset + amount;
+    for (auto& item : this->windows) {
+      auto const requested = item.offset + static_cast<i64>(this->size);
+      if (item.pending and item.offset <= first and last <= requested) { this->settle(); }
+    }
+    for (size_t idx = 0; idx < 2; ++idx) {
+      auto const& item = this->windows[idx];
+      if (not item.covers(first, last)) { continue; }
+      std::memcpy(out, item.data.data() + (first - item.offset), static_cast<size_t>(amount));
+      ::add(stats.coalesced, 1);
+      this->ahead(idx, stats);
+      this->last = last;
+      return SQLITE_OK;
+    }
+
+    auto const sequential = first == this->last;
+    this->last = last;
+    if (sequential and static_cast<size_t>(amount) * 2 <= this->size) {
+      this->settle();
+      auto& item = this->windows[0];
+      auto const result = ::fill(this->fd, item.data.data(), this->size, first);
+      if (result >= 0) {
+        item.offset = first;
+        item.length = static_cast<size_t>(result);
+        item.ready = true;
+        this->windows[1].ready = false;
+        if (item.covers(first, last)) {
+          std::memcpy(out, item.data.data(), static_cast<size_t>(amount));
+          this->ahead(0, stats);
+          return SQLITE_OK;
+        }
+      }
+    }
+
+    auto const result = ::fill(this->fd, static_cast<byte*>(out), static_cast<size_t>(amount), first);
+    if (result < 0) { return SQLITE_IOERR_READ; }
+    if (result < amount) {
+      std::memset(static_cast<byte*>(out) + result, 0, static_cast<size_t>(amount - result));
+      return SQLITE_IOERR_SHORT_READ;
+    }
+    return SQLITE_OK;
+  }
+
+#if defined(APEX_SQLITE_URING)
+  int write (void const* data, int amount, i64 offset, vfs::statistics& stats) noexcept {
+    this->invalidate();
+    auto const first = offset;
+    auto const last = offset + amount;
+    auto const overlaps = std::any_of(this->writes.begin(), this->writes.end(), [&] (auto const& item) {
+      return item.offset < last and first < item.offset + static_cast<i64>(item.data.size());
+    });
+    auto sqe = this->uring.next();
+    if (not sqe) {
+      if (auto result = this->drain(stats)) { return result; }
+      sqe = this->uring.next();
+    }
+    if (not sqe) { return SQLITE_IOERR_WRITE; }
+    try {
+      auto const bytes = static_cast<byte const*>(data);
+      auto& item = this->writes.emplace_back(pending { { bytes, bytes + amount }, { }, offset });
+      item.vector = iovec { item.data.data(), item.data.size() };
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->fd = this->fd;
+      sqe->off = static_cast<u64>(offset);
+      sqe->addr = reinterpret_cast<u64>(std::addressof(item.vector));
+      sqe->len = 1;
+      sqe->user_data = ::tag(kind::write, this->writes.size() - 1);
+      // Later writes to the same bytes must land after the earlier ones
+      if (overlaps) { sqe->flags |= IOSQE_IO_DRAIN; }
+      ++this->writing;
+    } catch (...) {
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = ::tag(kind::sync, 0);
+      ++this->writing;
+      this->drain(stats);
+      return SQLITE_IOERR_NOMEM;
+    }
+    // Submitted now, but only waited on once something depends on it
+    ::add(stats.submissions, 1);
+    if (this->uring.enter(0) < 0) { return this->drain(stats); }
+    return SQLITE_OK;
+  }
+
+  int sync (int flags, vfs::statistics& stats) noexcept {
+    auto sqe = this->uring.next();
+    if (not sqe) {
+      if (auto result = this->drain(stats)) { return result; }
+      sqe = this->uring.next();
+    }
+    if (not sqe) { return SQLITE_IOERR_FSYNC; }
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = this->fd;
+    sqe->fsync_flags = (flags & SQLITE_SYNC_DATAONLY) ? IORING_FSYNC_DATASYNC : 0;
+    // Runs once every queued write has completed
+    sqe->flags = IOSQE_IO_DRAIN;
+    sqe->user_data = ::tag(kind::sync, 0);
+    ++this->writing;
+    return this->drain(stats);
+  }
+
+  /* Completes every queued write (and sync), returning the first error */
+  int drain (vfs::statistics& stats) noexcept {
+    while (this->writing) {
+      ::add(stats.submissions, 1);
+      if (auto result = this->uring.enter(1); result < 0) {
+        this->failure = this->failure ? this->failure : SQLITE_IOERR_WRITE;
+        break;
+      }
+      this->reap();
+    }
+    this->writes.clear();
+    return std::exchange(this->failure, SQLITE_OK);
+  }
+
+  /* Waits for any readahead still in flight */
+  void settle () noexcept {
+    while (this->windows[0].pending or this->windows[1].pending) {
+      if (this->uring.enter(1) < 0) { break; }
+      this->reap();
+    }
+  }
+#else
+  int write (void const*, int, i64, vfs::statistics&) noexcept { return SQLITE_IOERR_WRITE; }
+  int sync (int, vfs::statistics&) noexcept { return SQLITE_IOERR_FSYNC; }
+  int drain (vfs::statistics&) noexcept { return SQLITE_OK; }
+  void settle () noexcept { }
+#endif /* defined(APEX_SQLITE_URING) */
+
+  /* Drops every readahead window */
+  void invalidate () noexcept {
+    this->settle();
+    for (auto& item : this->windows) { item.ready = false; }
+    this->last = -1;
+  }
+
+private:
+  // Starts reading the window after the one at idx into the other buffer,
+  // unless it is already there (or the end of the file has been reached).
+  void ahead ([[maybe_unused]] size_t idx, [[maybe_unused]] vfs::statistics& stats) noexcept {
+#if defined(APEX_SQLITE_URING)
+    auto const& current = this->windows[idx];
+    auto& other = this->windows[1 - idx];
+    if (not this->uring.valid() or current.length < this->size) { return; }
+    auto const offset = current.offset + static_cast<i64>(current.length);
+    if (other.pending or (other.ready and other.offset == offset)) { return; }
+    auto sqe = this->uring.next();
+    if (not sqe) { return; }
+    other.vector = iovec { other.data.data(), other.data.size() };
+    other.offset = offset;
+    other.ready = false;
+    other.pending = true;
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = this->fd;
+    sqe->off = static_cast<u64>(offset);
+    sqe->addr = reinterpret_cast<u64>(std::addressof(other.vector));
+    sqe->len = 1;
+    sqe->user_data = ::tag(kind::window, 1 - idx);
+    ::add(stats.submissions, 1);
+    if (this->uring.enter(0) < 0) { this->settle(); }
+#endif /* defined(APEX_SQLITE_URING) */
+  }
+
+#if defined(APEX_SQLITE_URING)
+  void reap () noexcept {
+    this->uring.reap([this] (u64 data, int result) noexcept {
+      auto const idx = static_cast<size_t>(data >> 8);
+      switch (static_cast<kind>(data & 0xff)) {
+        case kind::window: {
+          auto& item = this->windows[idx];
+          item.pending = false;
+          item.ready = result >= 0;
+          item.length = item.ready ? static_cast<size_t>(result) : 0;
+          break;
+        }
+        case kind::write: {
+          --this->writing;
+          auto const& item = this->writes[idx];
+          if (result < 0) { this->fail(::code(-result, SQLITE_IOERR_WRITE)); }
+          else if (static_cast<size_t>(result) < item.data.size()) { this->finish(item, static_cast<size_t>(result)); }
+          break;
+        }
+        case kind::sync:
+          --this->writing;
+          if (result < 0) { this->fail(SQLITE_IOERR_FSYNC); }
+          break;
+      }
+    });
+  }
+
+  /* Writes whatever a short write left out */
+  void finish (pending const& item, size_t done) noexcept {
+    while (done < item.data.size()) {
+      auto const offset = static_cast<off_t>(item.offset) + static_cast<off_t>(done);
+      auto const result = ::pwrite(this->fd, item.data.data() + done, item.data.size() - done, offset);
+      if (result < 0 and errno == EINTR) { continue; }
+      if (result <= 0) { return this->fail(::code(errno, SQLITE_IOERR_WRITE)); }
+      done += static_cast<size_t>(result);
+    }
+  }
+#endif /* defined(APEX_SQLITE_URING) */
+
+  void fail (int result) noexcept {
+    if (not this->failure) { this->failure = result; }
+  }
+
+  ring uring;
+  window windows[2];
+  std::deque<pending> writes;
+  int fd;
+  size_t size;
+  i64 last { -1 };
+  size_t writing { };
+  int failure { SQLITE_OK };
+  bool database;
+};
+
+} /* nameless namespace */
+
+namespace apex::sqlite {
+
+struct vfs::file final : sqlite3_file {
+  static int open (sqlite3_vfs*, char const*, sqlite3_file*, int, int*) noexcept;
+
+  static int close (sqlite3_file*) noexcept;
+  static int read (sqlite3_file*, void*, int, sqlite3_int64) noexcept;
+  static int write (sqlite3_file*, void const*, int, sqlite3_int64) noexcept;
+  static int truncate (sqlite3_file*, sqlite3_int64) noexcept;
+  static int sync (sqlite3_file*, int) noexcept;
+  static int size (sqlite3_file*, sqlite3_int64*) noexcept;
+  static int lock (sqlite3_file*, int) noexcept;
+  static int unlock (sqlite3_file*, int) noexcept;
+  static int reserved (sqlite3_file*, int*) noexcept;
+  static int control (sqlite3_file*, int, void*) noexcept;
+  static int sector (sqlite3_file*) noexcept;
+  static int device (sqlite3_file*) noexcept;
+  static int shm_map (sqlite3_file*, int, int, int, void volatile**) noexcept;
+  static int shm_lock (sqlite3_file*, int, int, int) noexcept;
+  static void shm_barrier (sqlite3_file*) noexcept;
+  static int shm_unmap (sqlite3_file*, int) noexcept;
+  static int fetch (sqlite3_file*, sqlite3_int64, int, void**) noexcept;
+  static int unfetch (sqlite3_file*, sqlite3_int64, void*) noexcept;
+
+  static sqlite3_io_methods const methods;
+
+  static file& self (sqlite3_file* ptr) noexcept { return *static_cast<file*>(ptr); }
+
+  /* The unix VFS's file lives right after this one */
+  sqlite3_file* real () noexcept { return reinterpret_cast<sqlite3_file*>(this + 1); }
+  sqlite3_io_methods const& base () noexcept { return *this->real()->pMethods; }
+
+  // Completes queued writes before anything else can see the file
+  int drain () noexcept { return this->stream ? this->stream->drain(*this->stats) : SQLITE_OK; }
+
+  // A journal must not change (or go away) before the database writes made
+  // ahead of it are complete, whether or not a sync came in between.
+  int order () noexcept { return this->database ? this->database->drain() : SQLITE_OK; }
+
+  std::shared_ptr<statistics> stats;
+  std::unique_ptr<::stream> stream;
+  /* The database this file is the rollback journal of, if any */
+  file* database { };
+};
+
+// sqlite only aligns files to eight bytes, and the real one follows this
+static_assert(sizeof(vfs::file) % 8 == 0);
+
+sqlite3_io_methods const vfs::file::methods {
+  3,
+  vfs::file::close,
+  vfs::file::read,
+  vfs::file::write,
+  vfs::file::truncate,
+  vfs::file::sync,
+  vfs::file::size,
+  vfs::file::lock,
+  vfs::file::unlock,
+  vfs::file::reserved,
+  vfs::file::control,
+  vfs::file::sector,
+  vfs::file::device,
+  vfs::file::shm_map,
+  vfs::file::shm_lock,
+  vfs::file::shm_barrier,
+  vfs::file::shm_unmap,
+  vfs::file::fetch,
+  vfs::file::unfetch,
+};
+
+int vfs::file::open (sqlite3_vfs* handle, char const* name, sqlite3_file* out, int flags, int* outflags) noexcept {
+  auto& owner = *static_cast<vfs*>(handle->pAppData);
+  auto item = ::new (static_cast<void*>(out)) file { };
+  auto real = item->real();
+  real->pMethods = nullptr;
+  auto result = owner.base->xOpen(owner.base, name, real, flags, outflags);
+  if (result != SQLITE_OK) {
+    // sqlite only closes what it opened when pMethods is set
+    if (real->pMethods) { real->pMethods->xClose(real); }
+    std::destroy_at(item);
+    out->pMethods = nullptr;
+    return result;
+  }
+  try {
+    item->stats = owner.lookup(name);
+    auto const fd = ::descriptor(owner.base, real, name);
+    if (fd >= 0 and not (flags & SQLITE_OPEN_WAL)) {
+      auto const database = (flags & SQLITE_OPEN_MAIN_DB) != 0;
+      item->stream = std::make_unique<::stream>(fd, owner.depth, owner.window, database, owner.supported);
+    }
+    if (flags & SQLITE_OPEN_MAIN_JOURNAL) {
+      auto main = sqlite3_database_file_object(name);
+      if (main and main->pMethods == std::addressof(methods)) { item->database = std::addressof(self(main)); }
+    }
+  } catch (...) {
+    real->pMethods->xClose(real);
+    std::destroy_at(item);
+    out->pMethods = nullptr;
+    return SQLITE_NOMEM;
+  }
+  item->pMethods = std::addressof(methods);
+  return SQLITE_OK;
+}
+
+// The journal is closed before it is deleted, so this also orders the delete
+int vfs::file::close (sqlite3_file* ptr) noexcept {
+  auto& item = self(ptr);
+  auto const ordered = item.order();
+  auto const drained = ordered ? ordered : item.drain();
+  if (item.stream) { item.stream->invalidate(); }
+  auto const result = item.base().xClose(item.real());
+  std::destroy_at(std::addressof(item));
+  return drained ? drained : result;
+}
+
+int vfs::file::read (sqlite3_file* ptr, void* out, int amount, sqlite3_int64 offset) noexcept {
+  auto& item = self(ptr);
+  auto const start = clock_type::now();
+  auto result = item.drain();
+  if (result == SQLITE_OK) {
+    result = item.stream
+      ? item.stream->read(out, amount, offset, *item.stats)
+      : item.base().xRead(item.real(), out, amount, offset);
+  }
+  item.stats->reads.record(clock_type::now() - start);
+  return result;
+}
+
+int vfs::file::write (sqlite3_file* ptr, void const* data, int amount, sqlite3_int64 offset) noexcept {
+  auto& item = self(ptr);
+  auto const start = clock_type::now();
+  auto result = item.order();
+  if (result == SQLITE_OK and item.stream and item.stream->deferred()) {
+    result = item.stream->write(data, amount, offset, *item.stats);
+  } else if (result == SQLITE_OK) {
+    if (item.stream) { item.stream->invalidate(); }
+    result = item.base().xWrite(item.real(), data, amount, offset);
+  }
+  item.stats->writes.record(clock_type::now() - start);
+  return result;
+}
+
+int vfs::file::truncate (sqlite3_file* ptr, sqlite3_int64 size) noexcept {
+  auto& item = self(ptr);
+  if (auto result = item.order()) { return result; }
+  if (auto result = item.drain()) { return result; }
+  if (item.stream) { item.stream->invalidate(); }
+  return item.base().xTruncate(item.real(), size);
+}
+
+int vfs::file::sync (sqlite3_file* ptr, int flags) noexcept {
+  auto& item = self(ptr);
+  auto const start = clock_type::now();
+  auto result = item.order();
+  if (result == SQLITE_OK) {
+    result = item.stream and item.stream->deferred()
+      ? item.stream->sync(flags, *item.stats)
+      : item.base().xSync(item.real(), flags);
+  }
+  item.stats->syncs.record(clock_type::now() - start);
+  return result;
+}
+
+int vfs::file::size (sqlite3_file* ptr, sqlite3_int64* out) noexcept {
+  auto& item = self(ptr);
+  if (auto result = item.drain()) { return result; }
+  return item.base().xFileSize(item.real(), out);
+}
+
+// Another connection may change the file as soon as its locks change, so
+// readahead never outlives them. The lock is changed even when a queued write
+// failed, so sqlite's idea of what is held stays true, and the failure is
+// reported afterwards.
+int vfs::file::lock (sqlite3_file* ptr, int level) noexcept {
+  auto& item = self(ptr);
+  auto const drained = item.drain();
+  if (item.stream) { item.stream->invalidate(); }
+  auto const result = item.base().xLock(item.real(), level);
+  return drained ? drained : result;
+}
+
+int vfs::file::unlock (sqlite3_file* ptr, int level) noexcept {
+  auto& item = self(ptr);
+  auto const drained = item.drain();
+  if (item.stream) { item.stream->invalidate(); }
+  auto const result = item.base().xUnlock(item.real(), level);
+  return drained ? drained : result;
+}
+
+int vfs::file::reserved (sqlite3_file* ptr, int* out) noexcept {
+  auto& item = self(ptr);
+  return item.base().xCheckReservedLock(item.real(), out);
+}
+
+int vfs::file::control (sqlite3_file* ptr, int op, void* arg) noexcept {
+  auto& item = self(ptr);
+  if (auto result = item.drain()) { return result; }
+  if (op == SQLITE_FCNTL_VFSNAME) {
+    auto name = static_cast<char**>(arg);
+    auto const result = item.base().xFileControl(item.real(), op, arg);
+    if (result == SQLITE_OK and *name) {
+      auto const wrapped = sqlite3_mprintf("apex/%z", *name);
+      *name = wrapped;
+    }
+    return result;
+  }
+  return item.base().xFileControl(item.real(), op, arg);
+}
+
+int vfs::file::sector (sqlite3_file* ptr) noexcept {
+  auto& item = self(ptr);
+  return item.base().xSectorSize(item.real());
+}
+
+int vfs::file::device (sqlite3_file* ptr) noexcept {
+  auto& item = self(ptr);
+  return item.base().xDeviceCharacteristics(item.real());
+}
+
+int vfs::file::shm_map (sqlite3_file* ptr, int page, int size, int extend, void volatile** out) noexcept {
+  auto& item = self(ptr);
+  if (item.base().iVersion < 2) { return SQLITE_IOERR_SHMMAP; }
+  return item.base().xShmMap(item.real(), page, size, extend, out);
+}
+
+int vfs::file::shm_lock (sqlite3_file* ptr, int offset, int count, int flags) noexcept {
+  auto& item = self(ptr);
+  if (item.base().iVersion < 2) { return SQLITE_IOERR_SHMLOCK; }
+  auto const drained = item.drain();
+  if (item.stream) { item.stream->invalidate(); }
+  auto const result = item.base().xShmLock(item.real(), offset, count, flags);
+  return drained ? drained : result;
+}
+
+void vfs::file::shm_barrier (sqlite3_file* ptr) noexcept {
+  auto& item = self(ptr);
+  if (item.base().iVersion < 2) { return; }
+  item.base().xShmBarrier(item.real());
+}
+
+int vfs::file::shm_unmap (sqlite3_file* ptr, int remove) noexcept {
+  auto& item = self(ptr);
+  if (item.base().iVersion < 2) { return SQLITE_OK; }
+  return item.base().xShmUnmap(item.real(), remove);
+}
+
+int vfs::file::fetch (sqlite3_file* ptr, sqlite3_int64 offset, int amount, void** out) noexcept {
+  auto& item = self(ptr);
+  *out = nullptr;
+  if (item.base().iVersion < 3) { return SQLITE_OK; }
+  if (auto result = item.drain()) { return result; }
+  return item.base().xFetch(item.real(), offset, amount, out);
+}
+
+int vfs::file::unfetch (sqlite3_file* ptr, sqlite3_int64 offset, void* page) noexcept {
+  auto& item = self(ptr);
+  if (item.base().iVersion < 3) { return SQLITE_OK; }
+  return item.base().xUnfetch(item.real(), offset, page);
+}
+
+vfs::vfs (std::string name, options opts) noexcept(false) :
+  handle { std::make_unique<sqlite3_vfs>() },
+  base { sqlite3_vfs_find(nullptr) },
+  label { std::move(name) },
+  depth { std::clamp<size_t>(opts.depth, 2, 4096) },
+  window { std::max<size_t>(opts.window, 4096) },
+  supported { opts.uring and ::available() }
+{
+  if (not this->base) { throw std::system_error(error::generic); }
+  auto& item = *this->handle;
+  item = *this->base;
+  item.pNext = nullptr;
+  item.zName = this->label.c_str();
+  item.pAppData = this;
+  item.szOsFile = static_cast<int>(sizeof(file)) + this->base->szOsFile;
+  item.xOpen = file::open;
+  // Everything else is handed to the unix VFS, which never looks at its
+  // own pAppData outside of xOpen.
+  if (auto result = sqlite3_vfs_register(std::addressof(item), opts.preferred)) {
+    throw std::system_error(error(result));
+  }
+}
+
+vfs::vfs (std::string name) noexcept(false) :
+  vfs { std::move(name), options { } }
+{ }
+
+vfs::~vfs () noexcept { sqlite3_vfs_unregister(this->handle.get()); }
+
+char const* vfs::name () const noexcept { return this->label.c_str(); }
+bool vfs::accelerated () const noexcept { return this->supported; }
+
+void vfs::visit (function_ref<void(std::string_view, statistics const&)> visitor) const noexcept(false) {
+  std::lock_guard lock { this->mutex };
+  for (auto const& [path, item] : this->entries) { visitor(path, *item); }
+}
+
+void vfs::clear () noexcept {
+  std::lock_guard lock { this->mutex };
+  for (auto& [path, item] : this->entries) {
+    item->reads.clear();
+    item->writes.clear();
+    item->syncs.clear();
+    item->coalesced.store(0, std::memory_order_relaxed);
+    item->submissions.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::shared_ptr<vfs::statistics> vfs::lookup (char const* path) noexcept(false) {
+  std::string_view const key { path ? path : "" };
+  std::lock_guard lock { this->mutex };
+  auto found = this->entries.find(key);
+  if (found == this->entries.end()) {
+    found = this->entries.emplace(std::string { key }, std::make_shared<statistics>()).first;
+  }
+  return found->second;
+}
+
+} /* namespace apex::sqlite */
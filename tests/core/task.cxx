@@ -0,0 +1,56 @@
+#include <apex/core/task.hpp>
+#include <stdexcept>
+
+namespace {
+
+// Runs a task to completion, as long as it never suspends on anything else
+template <class T>
+struct eager final {
+  struct promise_type {
+    eager get_return_object () noexcept { return { }; }
+    apex::suspend_never initial_suspend () const noexcept { return { }; }
+    apex::suspend_never final_suspend () const noexcept { return { }; }
+    void return_void () const noexcept { }
+    void unhandled_exception () const noexcept { }
+  };
+};
+
+apex::task<int> square (int x) { co_return x * x; }
+apex::task<int> sum (int x, int y) { co_return co_await square(x) + co_await square(y); }
+apex::task<> fail () {
+  throw std::runtime_error("fail");
+  co_return;
+}
+
+eager<void> drive (apex::task<int> work, int& out) { out = co_await std::move(work); }
+eager<void> drive (apex::task<> work, bool& caught) {
+  try { co_await std::move(work); }
+  catch (std::runtime_error const&) { caught = true; }
+}
+
+} /* nameless namespace */
+
+TEST_CASE("task") {
+  int result = 0;
+  drive(sum(3, 4), result);
+  REQUIRE(result == 25);
+}
+
+TEST_CASE("task (exception)") {
+  bool caught = false;
+  drive(fail(), caught);
+  REQUIRE(caught);
+}
+
+TEST_CASE("task (synchronous completion)") {
+  // Each co_await completes without suspending, which used to nest a stack
+  // frame per iteration until the stack overflowed
+  auto loop = [] (int count) -> apex::task<int> {
+    int total = 0;
+    for (int idx = 0; idx < count; ++idx) { total += co_await square(1); }
+    co_return total;
+  };
+  int result = 0;
+  drive(loop(1'000'000), result);
+  REQUIRE(result == 1'000'000);
+}
@@ -0,0 +1,30 @@
+#include <apex/detail/sqlite/fields.hpp>
+
+#include <string>
+#include <array>
+
+namespace {
+
+struct point { int x; int y; };
+struct record { long id; std::string name; double score; };
+
+} /* nameless namespace */
+
+TEST_CASE("fields count") {
+  using apex::detail::sqlite::field_count_v;
+  using tuple_type = std::tuple<int, char, float, double>;
+  using array_type = std::array<int, 5>;
+  STATIC_REQUIRE(field_count_v<point> == 2);
+  STATIC_REQUIRE(field_count_v<record> == 3);
+  STATIC_REQUIRE(field_count_v<tuple_type> == 4);
+  STATIC_REQUIRE(field_count_v<array_type> == 5);
+}
+
+TEST_CASE("fields tie") {
+  record item { 42, "apex", 1.5 };
+  auto fields = apex::detail::sqlite::tie(item);
+  std::get<0>(fields) = 7;
+  REQUIRE(item.id == 7);
+  REQUIRE(std::get<1>(fields) == "apex");
+  REQUIRE(std::get<2>(fields) == 1.5);
+}
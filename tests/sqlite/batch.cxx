@@ -0,0 +1,48 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/batch.hpp>
+
+namespace {
+
+using namespace apex::sqlite;
+
+size_t drain (statement& stmt, batch& into) {
+  size_t total = 0;
+  while (auto count = fetch(stmt, into, 4)) { total += count; }
+  return total;
+}
+
+} /* nameless namespace */
+
+TEST_CASE("fetch returns 0 once a statement is done, and then runs it again") {
+  connection conn { ":memory:" };
+  execute(conn, "CREATE TABLE items (id INTEGER)");
+  execute(conn, "INSERT INTO items VALUES (1), (2), (3), (4), (5), (6)");
+  batch rows;
+  {
+    auto stmt = conn.prepare("SELECT id FROM items");
+    REQUIRE(drain(*stmt, rows) == 6);
+  }
+  // The cache hands back the same statement, reset
+  auto stmt = conn.prepare("SELECT id FROM items");
+  REQUIRE(drain(*stmt, rows) == 6);
+  REQUIRE(fetch(*stmt, rows, 4) == 4);
+  stmt->reset();
+  REQUIRE(fetch(*stmt, rows, 4) == 4);
+  REQUIRE(rows.integers(0)[0] == 1);
+}
+
+TEST_CASE("fetch takes the layout of each new run") {
+  connection conn { ":memory:" };
+  auto stmt = conn.prepare("SELECT ?");
+  batch rows;
+  apex::sqlite::bind(*stmt, 1, apex::i64 { 7 });
+  REQUIRE(fetch(*stmt, rows, 4) == 1);
+  REQUIRE(rows.type(0) == affinity::integer);
+  REQUIRE(fetch(*stmt, rows, 4) == 0);
+  stmt->reset();
+  apex::sqlite::bind(*stmt, 1, std::string_view { "seven" });
+  REQUIRE(fetch(*stmt, rows, 4) == 1);
+  REQUIRE(rows.type(0) == affinity::text);
+  REQUIRE(rows.text(0, 0) == "seven");
+}
@@ -0,0 +1,50 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/deadline.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/row.hpp>
+
+#include <chrono>
+
+namespace {
+
+using namespace apex::sqlite;
+using namespace std::chrono_literals;
+
+constexpr auto endless = "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n) SELECT x FROM n";
+constexpr auto finite = "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 10) SELECT x FROM n";
+
+bool interrupted (std::system_error const& e) { return e.code() == error::interrupted; }
+
+} /* nameless namespace */
+
+TEST_CASE("deadline scope bounds iteration") {
+  connection conn { ":memory:" };
+  auto stmt = conn.prepare(endless);
+  bool stopped = false;
+  try {
+    deadline::scope bound { conn, deadline { 10ms } };
+    for (auto&& item : *stmt) { static_cast<void>(item); }
+  } catch (std::system_error const& e) { stopped = interrupted(e); }
+  REQUIRE(stopped);
+  stmt->reset();
+  // Once the scope is gone, nothing is bounded
+  size_t count = 0;
+  auto other = conn.prepare(finite);
+  for (auto&& item : *other) { static_cast<void>(item); ++count; }
+  REQUIRE(count == 10);
+}
+
+TEST_CASE("deadline scopes nest without losing the outer one") {
+  connection conn { ":memory:" };
+  std::stop_source source;
+  deadline::scope outer { conn, deadline { source.get_token() } };
+  // An inner deadline neither clears nor extends the outer one
+  conn.prepare(finite)->execute(deadline { 1h });
+  source.request_stop();
+  REQUIRE_THROWS_AS(conn.prepare(endless)->execute(deadline { 1h }), std::system_error);
+  bool stopped = false;
+  try { conn.prepare(endless)->execute(); }
+  catch (std::system_error const& e) { stopped = interrupted(e); }
+  REQUIRE(stopped);
+}
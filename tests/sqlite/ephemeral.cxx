@@ -0,0 +1,100 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/ephemeral.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/row.hpp>
+#include <sqlite3.h>
+
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <tuple>
+
+namespace {
+
+using namespace apex::sqlite;
+
+template <class T>
+T scalar (connection& conn, std::string_view sql) {
+  auto stmt = conn.prepare(sql);
+  auto [value] = row { *stmt }.as<std::tuple<T>>();
+  stmt->reset();
+  return value;
+}
+
+/* memfds backing ephemeral files that are still alive */
+size_t backed () {
+  size_t count = 0;
+  for (auto const& entry : std::filesystem::directory_iterator { "/proc/self/fd" }) {
+    std::error_code ec;
+    auto const target = std::filesystem::read_symlink(entry.path(), ec).string();
+    if (not ec and target.find("memfd:apex-sqlite") != std::string::npos) { ++count; }
+  }
+  return count;
+}
+
+} /* nameless namespace */
+
+TEST_CASE("ephemeral shares a WAL database between connections") {
+  ephemeral scratch { "apex-test-shared" };
+  connection writer { "jobs.db", access::read_write, scratch.name() };
+  REQUIRE(scalar<std::string>(writer, "PRAGMA journal_mode=WAL") == "wal");
+  execute(writer, "CREATE TABLE jobs (id INTEGER PRIMARY KEY, body TEXT)");
+  connection reader { "jobs.db", access::read_only, scratch.name() };
+
+  constexpr apex::i64 total = 2000;
+  std::atomic<bool> done { false };
+  std::thread thread { [&] {
+    for (apex::i64 idx = 0; idx < total; ++idx) {
+      execute(writer, "INSERT INTO jobs (body) VALUES (hex(randomblob(32)))");
+    }
+    done = true;
+  } };
+  // Readers never wait on the writer in WAL mode, and never see a row go away
+  apex::i64 seen = 0;
+  bool monotonic = true;
+  while (not done) {
+    auto const count = scalar<apex::i64>(reader, "SELECT count(*) FROM jobs");
+    monotonic = monotonic and count >= seen;
+    seen = count;
+  }
+  thread.join();
+  REQUIRE(monotonic);
+  REQUIRE(scalar<apex::i64>(reader, "SELECT count(*) FROM jobs") == total);
+  REQUIRE(scalar<std::string>(reader, "PRAGMA integrity_check") == "ok");
+}
+
+TEST_CASE("ephemeral frees files once they are removed and closed") {
+  ephemeral scratch { "apex-test-remove", ephemeral::options { .memfd = true } };
+  auto const before = backed();
+  {
+    connection conn { "data.db", access::read_write, scratch.name() };
+    execute(conn, "CREATE TABLE items (body TEXT)");
+    execute(conn, "INSERT INTO items VALUES (hex(randomblob(4096)))");
+    REQUIRE(scratch.size() > 0);
+    REQUIRE(backed() == before + 1);
+    REQUIRE(scratch.remove("data.db"));
+    REQUIRE(not scratch.remove("data.db"));
+    REQUIRE(scratch.size() == 0);
+    // Still readable while open
+    REQUIRE(scalar<apex::i64>(conn, "SELECT count(*) FROM items") == 1);
+  }
+  REQUIRE(backed() == before);
+  REQUIRE_THROWS_AS(connection("data.db", access::read_only, scratch.name()), std::system_error);
+
+  auto vfs = sqlite3_vfs_find(scratch.name());
+  REQUIRE(vfs);
+  auto storage = std::make_unique<std::max_align_t[]>(static_cast<size_t>(vfs->szOsFile) / sizeof(std::max_align_t) + 1);
+  auto file = reinterpret_cast<sqlite3_file*>(storage.get());
+  auto const flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_DELETEONCLOSE | SQLITE_OPEN_TEMP_JOURNAL;
+  REQUIRE(vfs->xOpen(vfs, "scratch.tmp", file, flags, nullptr) == SQLITE_OK);
+  char const data[] = "ephemeral";
+  REQUIRE(file->pMethods->xWrite(file, data, sizeof(data), 0) == SQLITE_OK);
+  REQUIRE(backed() == before + 1);
+  REQUIRE(file->pMethods->xClose(file) == SQLITE_OK);
+  REQUIRE(backed() == before);
+  int exists = 1;
+  vfs->xAccess(vfs, "scratch.tmp", SQLITE_ACCESS_EXISTS, &exists);
+  REQUIRE(not exists);
+}
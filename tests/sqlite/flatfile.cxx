@@ -0,0 +1,137 @@
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/flatfile.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/row.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <tuple>
+
+namespace {
+
+using namespace apex::sqlite;
+
+std::filesystem::path write (std::string const& name, std::string_view text) {
+  auto path = std::filesystem::temp_directory_path() / ("apex-flatfile-" + name);
+  std::ofstream { path, std::ios::binary | std::ios::trunc }.write(text.data(), static_cast<std::streamsize>(text.size()));
+  return path;
+}
+
+void mount (connection& conn, std::shared_ptr<flatfile> file) {
+  plugin(conn, "flatfile", std::move(file));
+  execute(conn, "CREATE VIRTUAL TABLE temp.file USING flatfile");
+}
+
+template <class T>
+std::vector<T> query (connection& conn, std::string_view sql) {
+  std::vector<T> rows;
+  auto stmt = conn.prepare(sql);
+  for (auto const& item : *stmt) { rows.push_back(item.template as<T>()); }
+  return rows;
+}
+
+} /* nameless namespace */
+
+TEST_CASE("flatfile header names") {
+  auto path = write("header.csv", "id,first name,\"total, in cents\"\n1,ada,100\n");
+  connection conn { ":memory:" };
+  mount(conn, std::make_shared<flatfile>(path, flatfile::delimited { .header = true }));
+  using info = std::tuple<std::string, std::string>;
+  auto columns = query<info>(conn, "SELECT name, type FROM pragma_table_info('file')");
+  REQUIRE(columns.size() == 3);
+  REQUIRE(columns[1] == info { "first name", "" });
+  REQUIRE(columns[2] == info { "total, in cents", "" });
+  auto rows = query<std::tuple<std::string, std::string>>(conn, R"(SELECT "first name", "total, in cents" FROM file)");
+  REQUIRE(rows.size() == 1);
+  REQUIRE(std::get<0>(rows[0]) == "ada");
+  REQUIRE(std::get<1>(rows[0]) == "100");
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("flatfile declared types") {
+  auto path = write("types.csv", "7,2.5,x\n");
+  connection conn { ":memory:" };
+  std::vector<std::string> columns { "id INTEGER", "score REAL", "note" };
+  mount(conn, std::make_shared<flatfile>(path, flatfile::delimited { }, columns));
+  auto rows = query<std::tuple<std::string, std::string, std::string>>(conn, "SELECT typeof(id), typeof(score), typeof(note) FROM file");
+  REQUIRE(rows.size() == 1);
+  REQUIRE(rows[0] == std::tuple<std::string, std::string, std::string> { "integer", "real", "text" });
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("flatfile quoted and escaped fields") {
+  auto path = write("quoted.csv", "1,\"a, b\",\"say \"\"hi\"\"\"\n2,plain,\"\"\n");
+  connection conn { ":memory:" };
+  mount(conn, std::make_shared<flatfile>(path, flatfile::delimited { }));
+  auto rows = query<std::tuple<apex::i64, std::string, std::string>>(conn, "SELECT rowid, c2, c3 FROM file");
+  REQUIRE(rows.size() == 2);
+  REQUIRE(std::get<1>(rows[0]) == "a, b");
+  REQUIRE(std::get<2>(rows[0]) == "say \"hi\"");
+  REQUIRE(std::get<1>(rows[1]) == "plain");
+  REQUIRE(std::get<2>(rows[1]).empty());
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("flatfile line endings") {
+  auto path = write("crlf.csv", "a,1\r\nb,2\r\nc,3");
+  connection conn { ":memory:" };
+  auto file = std::make_shared<flatfile>(path, flatfile::delimited { }, std::vector<std::string> { "name TEXT", "size INTEGER" });
+  REQUIRE(file->lines() == 3);
+  mount(conn, file);
+  auto rows = query<std::tuple<std::string, std::string>>(conn, "SELECT name, typeof(size) FROM file");
+  REQUIRE(rows.size() == 3);
+  for (auto const& [name, type] : rows) {
+    REQUIRE(name.size() == 1);
+    REQUIRE(type == "integer");
+  }
+  REQUIRE(std::get<0>(rows[2]) == "c");
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("flatfile missing fields") {
+  auto path = write("missing.csv", "1,2,3\n4\n");
+  connection conn { ":memory:" };
+  mount(conn, std::make_shared<flatfile>(path, flatfile::delimited { }));
+  auto rows = query<std::tuple<std::string>>(conn, "SELECT typeof(c3) FROM file WHERE rowid = 2");
+  REQUIRE(rows.size() == 1);
+  REQUIRE(std::get<0>(rows[0]) == "null");
+  std::filesystem::remove(path);
+}
+
+// Seeks start from every 64th line, so these land on either side of a mark
+TEST_CASE("flatfile rowid seeks") {
+  std::string text;
+  for (int idx = 1; idx <= 200; ++idx) { text += std::to_string(idx) + '\n'; }
+  auto path = write("seek.csv", text);
+  connection conn { ":memory:" };
+  mount(conn, std::make_shared<flatfile>(path, flatfile::delimited { }, std::vector<std::string> { "n INTEGER" }));
+  for (apex::i64 rowid : { 1, 63, 64, 65, 128, 129, 192, 193, 200 }) {
+    auto rows = query<std::tuple<apex::i64>>(conn, "SELECT n FROM file WHERE rowid = " + std::to_string(rowid));
+    REQUIRE(rows.size() == 1);
+    REQUIRE(std::get<0>(rows[0]) == rowid);
+  }
+  REQUIRE(query<std::tuple<apex::i64>>(conn, "SELECT n FROM file WHERE rowid = 201").empty());
+  REQUIRE(query<std::tuple<apex::i64>>(conn, "SELECT n FROM file WHERE rowid = 0").empty());
+  auto range = query<std::tuple<apex::i64>>(conn, "SELECT n FROM file WHERE rowid BETWEEN 62 AND 66");
+  REQUIRE(range.size() == 5);
+  REQUIRE(std::get<0>(range.front()) == 62);
+  REQUIRE(std::get<0>(range.back()) == 66);
+  auto tail = query<std::tuple<apex::i64>>(conn, "SELECT count(*) FROM file WHERE rowid > 190");
+  REQUIRE(std::get<0>(tail[0]) == 10);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("flatfile empty file") {
+  auto path = write("empty.csv", "");
+  connection conn { ":memory:" };
+  auto file = std::make_shared<flatfile>(path, flatfile::delimited { }, std::vector<std::string> { "n INTEGER" });
+  REQUIRE(file->lines() == 0);
+  mount(conn, file);
+  REQUIRE(std::get<0>(query<std::tuple<apex::i64>>(conn, "SELECT count(*) FROM file")[0]) == 0);
+  REQUIRE(query<std::tuple<apex::i64>>(conn, "SELECT n FROM file WHERE rowid = 1").empty());
+  // Without declarations or a header, there is nothing to name the columns after
+  REQUIRE_THROWS_AS(flatfile(path, flatfile::delimited { }), std::system_error);
+  std::filesystem::remove(path);
+}
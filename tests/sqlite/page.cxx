@@ -0,0 +1,72 @@
+#include <apex/sqlite/page.hpp>
+#include <sqlite3.h>
+
+namespace {
+
+using namespace apex::sqlite;
+
+// Installing a page cache requires sqlite to be shut down, so the methods are
+// fetched back out of sqlite before it is initialized again.
+sqlite3_pcache_methods2 slab () {
+  sqlite3_shutdown();
+  install(page_cache::slab);
+  sqlite3_pcache_methods2 methods { };
+  sqlite3_config(SQLITE_CONFIG_GETPCACHE2, &methods);
+  sqlite3_initialize();
+  return methods;
+}
+
+void restore () {
+  sqlite3_shutdown();
+  install(page_cache::system);
+  sqlite3_initialize();
+}
+
+} /* nameless namespace */
+
+TEST_CASE("slab page cache keeps caching after going over capacity") {
+  auto methods = slab();
+  auto cache = methods.xCreate(4096, 64, 1);
+  REQUIRE(cache);
+  methods.xCachesize(cache, 4);
+
+  sqlite3_pcache_page* pinned[5] { };
+  for (unsigned key = 1; key <= 4; ++key) {
+    pinned[key - 1] = methods.xFetch(cache, key, 1);
+    REQUIRE(pinned[key - 1]);
+  }
+  // Every page is pinned, so only create == 2 may go past capacity
+  REQUIRE(not methods.xFetch(cache, 5, 1));
+  pinned[4] = methods.xFetch(cache, 5, 2);
+  REQUIRE(pinned[4]);
+  for (auto page : pinned) { methods.xUnpin(cache, page, 0); }
+  REQUIRE(methods.xPagecount(cache) == 4);
+
+  // Back at capacity, pages are cached again once unpinned
+  auto page = methods.xFetch(cache, 6, 1);
+  REQUIRE(page);
+  methods.xUnpin(cache, page, 0);
+  REQUIRE(methods.xFetch(cache, 6, 0));
+  methods.xUnpin(cache, page, 0);
+  REQUIRE(methods.xPagecount(cache) == 4);
+
+  methods.xDestroy(cache);
+  restore();
+}
+
+TEST_CASE("slab page cache evicts when resized") {
+  auto methods = slab();
+  auto cache = methods.xCreate(4096, 64, 1);
+  REQUIRE(cache);
+  methods.xCachesize(cache, 16);
+  for (unsigned key = 1; key <= 16; ++key) {
+    auto page = methods.xFetch(cache, key, 1);
+    REQUIRE(page);
+    methods.xUnpin(cache, page, 0);
+  }
+  REQUIRE(methods.xPagecount(cache) == 16);
+  methods.xCachesize(cache, 2);
+  REQUIRE(methods.xPagecount(cache) == 2);
+  methods.xDestroy(cache);
+  restore();
+}
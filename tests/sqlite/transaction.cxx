@@ -0,0 +1,55 @@
+#include <apex/sqlite/transaction.hpp>
+#include <apex/sqlite/connection.hpp>
+#include <apex/sqlite/statement.hpp>
+#include <apex/sqlite/error.hpp>
+#include <apex/sqlite/row.hpp>
+
+#include <filesystem>
+#include <tuple>
+
+namespace {
+
+using namespace apex::sqlite;
+
+apex::i64 count (connection& conn) {
+  auto stmt = conn.prepare("SELECT count(*) FROM items");
+  auto [total] = row { *stmt }.as<std::tuple<apex::i64>>();
+  stmt->reset();
+  return total;
+}
+
+} /* nameless namespace */
+
+TEST_CASE("transaction commits only when asked") {
+  connection conn { ":memory:" };
+  execute(conn, "CREATE TABLE items (id INTEGER)");
+  {
+    transaction tx { conn, behavior::immediate };
+    execute(conn, "INSERT INTO items VALUES (1)");
+    tx.commit();
+  }
+  REQUIRE(count(conn) == 1);
+  {
+    transaction tx { conn, behavior::immediate };
+    execute(conn, "INSERT INTO items VALUES (2)");
+  }
+  REQUIRE(count(conn) == 1);
+  REQUIRE(conn.autocommit());
+}
+
+TEST_CASE("transaction reports a failure to begin") {
+  auto path = std::filesystem::temp_directory_path() / "apex-transaction.db";
+  std::filesystem::remove(path);
+  connection first { path };
+  connection second { path };
+  execute(first, "CREATE TABLE items (id INTEGER)");
+  transaction held { first, behavior::immediate };
+  REQUIRE_THROWS_AS(transaction(second, behavior::immediate), std::system_error);
+  REQUIRE(second.autocommit());
+  // Nor can one begin inside another, and the outer one is left alone
+  REQUIRE_THROWS_AS(transaction(first, behavior::deferred), std::system_error);
+  REQUIRE(not first.autocommit());
+  held.commit();
+  REQUIRE(first.autocommit());
+  std::filesystem::remove(path);
+}